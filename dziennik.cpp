@@ -0,0 +1,345 @@
+/**
+ * @file dziennik.cpp
+ * @brief single-producer operation log in POSIX shared memory
+ *
+ * The ring is a header followed by a power-of-two array of entries. Entry
+ * with sequence number s (counted from 1) lives in slot s & mask, and its seq
+ * field works as a seqlock: the producer invalidates it, writes the payload
+ * and publishes s with release semantics. A reader accepts an entry only if
+ * it saw the expected s both before and after copying the payload.
+ */
+
+#include "dziennik.h"
+#include "kol.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr uint64_t log_magic = 0x6b6f6c656a6b6931; // "kolejki1"
+    constexpr uint64_t busy = ~(uint64_t)0;
+
+    struct log_entry
+    {
+        std::atomic<uint64_t> seq;
+        std::atomic<int32_t> op;
+        std::atomic<int32_t> a;
+        std::atomic<int32_t> b;
+        std::atomic<int32_t> c;
+    };
+
+    struct log_header
+    {
+        uint64_t magic;
+        uint64_t capacity;
+        std::atomic<uint64_t> head; // sequence number of the last written entry
+        log_entry entries[1];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<int32_t>::is_always_lock_free,
+                  "shared memory atomics have to be address free");
+
+    size_t ring_bytes(uint64_t capacity)
+    { return offsetof(log_header, entries) + capacity * sizeof(log_entry); }
+
+    /**
+     * @brief maps a named shared memory object, creating it if size is given
+     *
+     * @param size size of a new object, 0 to open an existing one; set to the
+     * size of the mapping
+     */
+    log_header *map_ring(const char *name, size_t &size)
+    {
+        bool create = size != 0;
+        int fd = create ? shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600)
+                        : shm_open(name, O_RDONLY, 0);
+        if(fd < 0)
+            return nullptr;
+
+        if(!create)
+        {
+            struct stat st;
+            if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(log_header))
+            {
+                close(fd);
+                return nullptr;
+            }
+            size = (size_t)st.st_size;
+        }
+        else if(ftruncate(fd, (off_t)size) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        int prot = create ? PROT_READ | PROT_WRITE : PROT_READ;
+        void *mem = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+        close(fd);
+        return mem == MAP_FAILED ? nullptr : (log_header*)mem;
+    }
+
+    struct producer
+    {
+        log_header *ring = nullptr;
+        uint64_t mask = 0;
+        uint64_t seq = 0;
+        std::string name;
+    };
+
+    // like the hall itself, the published log belongs to one thread
+    thread_local producer primary;
+}
+
+struct replika
+{
+    log_header *ring;
+    size_t mapped;
+    uint64_t mask;
+    uint64_t next;     // sequence number of the next entry to apply
+    uint64_t lost;
+    std::vector<interesant*> by_number;
+};
+
+bool publikuj_dziennik(const char *nazwa, unsigned pojemnosc)
+{
+    zakoncz_dziennik();
+
+    uint64_t capacity = 1;
+    while(capacity < pojemnosc)
+        capacity <<= 1;
+
+    size_t size = ring_bytes(capacity);
+    log_header *ring = map_ring(nazwa, size);
+    if(!ring)
+        return false;
+
+    // a fresh object from ftruncate is zero filled, so every seq starts at 0
+    ring->capacity = capacity;
+    ring->head.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = log_magic;
+
+    primary.ring = ring;
+    primary.mask = capacity - 1;
+    primary.seq = 0;
+    primary.name = nazwa;
+    return true;
+}
+
+void zakoncz_dziennik()
+{
+    if(!primary.ring)
+        return;
+
+    munmap(primary.ring, ring_bytes(primary.mask + 1));
+    shm_unlink(primary.name.c_str());
+    primary = producer();
+}
+
+void dziennik_zapisz(operacja op, int a, int b, int c)
+{
+    if(!primary.ring)
+        return;
+
+    uint64_t s = ++primary.seq;
+    log_entry &e = primary.ring->entries[s & primary.mask];
+
+    e.seq.store(busy, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.op.store((int32_t)op, std::memory_order_relaxed);
+    e.a.store(a, std::memory_order_relaxed);
+    e.b.store(b, std::memory_order_relaxed);
+    e.c.store(c, std::memory_order_relaxed);
+    e.seq.store(s, std::memory_order_release);
+    primary.ring->head.store(s, std::memory_order_release);
+}
+
+replika *dolacz_do_dziennika(const char *nazwa)
+{
+    size_t size = 0;
+    log_header *ring = map_ring(nazwa, size);
+    if(!ring)
+        return nullptr;
+
+    // a foreign or truncated object must not send readers past the mapping
+    uint64_t capacity = ring->capacity;
+    if(ring->magic != log_magic || capacity == 0 || (capacity & (capacity - 1))
+       || capacity > (size - offsetof(log_header, entries)) / sizeof(log_entry))
+    {
+        munmap(ring, size);
+        return nullptr;
+    }
+
+    return new replika{ring, size, capacity - 1, 1, 0, {}};
+}
+
+/**
+ * @brief finds a customer of the replica by the number logged by the primary
+ *
+ * @return false if the replica never saw that customer come
+ */
+static bool customer(replika *r, int num, interesant *&out)
+{
+    if(num < 0 || (size_t)num >= r->by_number.size() || !r->by_number[(size_t)num])
+        return false;
+    out = r->by_number[(size_t)num];
+    return true;
+}
+
+/**
+ * @brief frees customers that left the replica's hall, as the primary's
+ * caller does with its own copies
+ */
+static void release(replika *r, const std::vector<interesant*> &gone)
+{
+    for(interesant *i : gone)
+    {
+        size_t num = (size_t)numerek(i);
+        if(num < r->by_number.size() && r->by_number[num] == i)
+            r->by_number[num] = nullptr;
+        free(i);
+    }
+}
+
+/**
+ * @brief applies a single logged operation to the hall of the calling thread
+ *
+ * @return false if the entry refers to a customer the replica does not know,
+ * which means it missed part of the log
+ */
+static bool apply(replika *r, operacja op, int a, int b, int c)
+{
+    interesant *i1 = nullptr, *i2 = nullptr;
+    switch(op)
+    {
+    case operacja::otwarcie_urzedu:
+        otwarcie_urzedu(a);
+        break;
+    case operacja::otworz_okienko:
+        otworz_okienko();
+        break;
+    case operacja::usun_okienko:
+        usun_okienko(a);
+        break;
+    case operacja::nowy_interesant:
+        r->by_number.push_back(nowy_interesant(a));
+        break;
+    case operacja::obsluz:
+        if((i1 = obsluz(a)))
+            release(r, {i1});
+        break;
+    case operacja::zmiana_okienka:
+        if(!customer(r, a, i1))
+            return false;
+        zmiana_okienka(i1, b);
+        break;
+    case operacja::zamkniecie_okienka:
+        zamkniecie_okienka(a, b);
+        break;
+    case operacja::fast_track:
+        if(!customer(r, a, i1) || !customer(r, b, i2))
+            return false;
+        release(r, fast_track(i1, i2));
+        break;
+    case operacja::naczelnik:
+        naczelnik(a);
+        break;
+    case operacja::zamkniecie_urzedu:
+        release(r, zamkniecie_urzedu());
+        break;
+    case operacja::naczelnik_zakres:
+        if(!customer(r, a, i1) || !customer(r, b, i2))
+            return false;
+        naczelnik_zakres(i1, i2);
+        break;
+    case operacja::na_poczatek:
+        if(!customer(r, a, i1) || !customer(r, b, i2))
+            return false;
+        na_poczatek(i1, i2, c);
+        break;
+    case operacja::obroc:
+        if(!customer(r, b, i1))
+            return false;
+        obroc(a, i1);
+        break;
+    case operacja::obsluz_z_kradzieza:
+        if((i1 = obsluz_z_kradzieza(a, (kradziez)b)))
+            release(r, {i1});
+        break;
+    case operacja::zamykanie_start:
+        zamykanie_start();
+        break;
+    case operacja::zamykanie_krok:
+    {
+        std::vector<interesant*> out;
+        zamykanie_krok(a, out);
+        release(r, out);
+        break;
+    }
+    }
+    return true;
+}
+
+long long odtworz_dziennik(replika *r, long long maks)
+{
+    if(r->lost)
+        return -1;
+
+    long long done = 0;
+    uint64_t head = r->ring->head.load(std::memory_order_acquire);
+
+    while(done < maks && r->next <= head)
+    {
+        if(head - r->next > r->mask)
+        {
+            r->lost = head - r->next - r->mask;
+            return -1;
+        }
+
+        log_entry &e = r->ring->entries[r->next & r->mask];
+        uint64_t before = e.seq.load(std::memory_order_acquire);
+        operacja op = (operacja)e.op.load(std::memory_order_relaxed);
+        int a = e.a.load(std::memory_order_relaxed);
+        int b = e.b.load(std::memory_order_relaxed);
+        int c = e.c.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = e.seq.load(std::memory_order_relaxed);
+
+        if(before != r->next || after != r->next)
+        {
+            // the producer lapped us while we were reading this slot
+            r->lost = r->ring->head.load(std::memory_order_acquire) - r->next - r->mask;
+            if(r->lost == 0)
+                r->lost = 1;
+            return -1;
+        }
+
+        if(!apply(r, op, a, b, c))
+        {
+            r->lost = 1;
+            return -1;
+        }
+        ++r->next;
+        ++done;
+    }
+
+    return done;
+}
+
+unsigned long long utracone_wpisy(replika *r)
+{ return r->lost; }
+
+void odlacz_od_dziennika(replika *r)
+{
+    munmap(r->ring, r->mapped);
+    delete r;
+}
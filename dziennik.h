@@ -0,0 +1,124 @@
+#ifndef DZIENNIK_H
+#define DZIENNIK_H
+
+/**
+ * @file dziennik.h
+ * @brief log of hall operations in POSIX shared memory, for a hot-standby
+ * replica running in another process
+ */
+
+// Urząd główny zapisuje każdą operację zmieniającą kolejki do bufora
+// cyklicznego w pamięci współdzielonej. Zapis nigdy nie czeka na replikę:
+// jeśli replika nie nadąża, najstarsze wpisy są nadpisywane, a replika
+// wykrywa lukę po numerach kolejnych wpisów.
+
+/**
+ * @brief Rodzaje operacji zapisywanych w dzienniku
+ */
+enum class operacja : int
+{
+    otwarcie_urzedu,    // a = m
+    otworz_okienko,
+    usun_okienko,       // a = k
+    nowy_interesant,    // a = k
+    obsluz,             // a = k
+    zmiana_okienka,     // a = numerek i, b = k
+    zamkniecie_okienka, // a = k1, b = k2
+    fast_track,         // a = numerek i1, b = numerek i2
+    naczelnik,          // a = k
+    zamkniecie_urzedu,
+    naczelnik_zakres,   // a = numerek i1, b = numerek i2
+    na_poczatek,        // a = numerek i1, b = numerek i2, c = k
+    obroc,              // a = k, b = numerek i
+    obsluz_z_kradzieza, // a = k, b = polityka
+    zamykanie_start,
+    zamykanie_krok      // a = budzet
+};
+
+/**
+ * @brief Zaczyna publikować operacje urzędu w pamięci współdzielonej
+ *
+ * Tworzy (lub nadpisuje) obiekt pamięci współdzielonej o podanej nazwie.
+ * Publikowane są operacje na urzędzie wątku, który wywołał tę funkcję.
+ * Operacje wykonane przed wywołaniem nie trafiają do dziennika, więc replika
+ * powinna zacząć od pustego urzędu.
+ *
+ * @param nazwa nazwa obiektu dla shm_open, np. "/kolejki"
+ * @param pojemnosc liczba wpisów bufora, zaokrąglana w górę do potęgi dwójki
+ * @return true jeśli się udało, false w przeciwnym przypadku
+ */
+
+bool publikuj_dziennik(const char *nazwa, unsigned pojemnosc);
+
+/**
+ * @brief Przestaje publikować operacje i usuwa obiekt pamięci współdzielonej
+ *
+ * Repliki, które już go otworzyły, mogą dokończyć odczyt.
+ */
+
+void zakoncz_dziennik();
+
+/**
+ * @brief Zapisuje operację do dziennika, jeśli jest publikowany
+ *
+ * Wywoływana przez operacje urzędu; nie blokuje.
+ *
+ * Złożoność czasowa O(1)
+ */
+
+void dziennik_zapisz(operacja op, int a = 0, int b = 0, int c = 0);
+
+struct replika;
+
+/**
+ * @brief Otwiera dziennik publikowany przez inny proces
+ *
+ * Odtwarzane operacje są wykonywane na urzędzie wątku, który wywołuje
+ * "odtworz_dziennik".
+ *
+ * @param nazwa nazwa obiektu przekazana do "publikuj_dziennik"
+ * @return replika* uchwyt repliki lub NULL, jeśli nie udało się otworzyć
+ * albo obiekt nie jest całym dziennikiem
+ */
+
+replika *dolacz_do_dziennika(const char *nazwa);
+
+/**
+ * @brief Wykonuje na lokalnym urzędzie operacje z dziennika, których replika
+ * jeszcze nie widziała
+ *
+ * Interesantów, którzy opuszczają urząd repliki (obsłużonych, przepuszczonych
+ * przez fast_track, oddanych przy zamykaniu), replika zwalnia sama. Tych,
+ * którzy nadal stoją w kolejkach, zwalnia wątek repliki, jak każdy inny
+ * użytkownik biblioteki.
+ *
+ * @param r uchwyt repliki
+ * @param maks największa liczba operacji do wykonania
+ * @return long long liczba wykonanych operacji lub -1, jeśli część wpisów
+ * została nadpisana, zanim replika je przeczytała, albo wpis dotyczy
+ * interesanta, którego przyjścia replika nie widziała; wtedy stan repliki nie
+ * odpowiada już urzędowi głównemu
+ */
+
+long long odtworz_dziennik(replika *r, long long maks);
+
+/**
+ * @brief Zwraca liczbę wpisów utraconych w wykrytej luce
+ *
+ * @param r uchwyt repliki
+ * @return unsigned long long liczba utraconych wpisów, 0 jeśli luki nie było;
+ * 1, jeśli lukę wykryto po nieznanym numerku interesanta i jej długość nie
+ * jest znana
+ */
+
+unsigned long long utracone_wpisy(replika *r);
+
+/**
+ * @brief Zamyka dziennik po stronie repliki i zwalnia uchwyt
+ *
+ * @param r uchwyt repliki
+ */
+
+void odlacz_od_dziennika(replika *r);
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * @file interesant.h
+ * @brief layout of a customer, shared by the runtime-sized and the fixed-size hall
+ */
+
+#include "plist.h"
+#include <cstdint>
+
+struct window_tag;
+
+struct interesant
+{ 
+    int num;
+    plib::list<interesant*>::const_iterator it;
+    window_tag *tag;  // tag of the window at the time of joining, see kol.cpp
+    uint64_t arrived; // clock ticks, 0 if time was not being measured
+    uint64_t moved;   // last zmiana_okienka
+    uint64_t served;  // obsluz or fast_track
+};
@@ -10,87 +10,1119 @@
  */
 
 #include "plist.h"
+#include "interesant.h"
 #include "kol.h"
+#include "dziennik.h"
+#include "kol_coro.h"
+#include "kol_plik.h"
 #include <vector>
+#include <deque>
 #include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 
-struct interesant
-{ 
-    int num;
-    plib::list<interesant*>::const_iterator it;
+/**
+ * @brief reads a cheap monotonic clock: TSC where available, steady_clock otherwise
+ */
+static inline uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @struct latency_histogram
+ * @brief streaming quantile estimator with log-linear buckets
+ *
+ * Values below 16 get their own bucket, larger ones are split into 16
+ * buckets per power of two, so a reported quantile is off by at most 1/16.
+ * Recording is O(1), a query scans the buckets.
+ */
+struct latency_histogram
+{
+    static constexpr int sub_bits = 4;
+    static constexpr int sub_count = 1 << sub_bits;
+    static constexpr int bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    std::vector<uint64_t> buckets; // allocated on the first record
+    uint64_t total = 0;
+
+    static int bucket(uint64_t v)
+    {
+        if(v < sub_count)
+            return (int)v;
+        int e = 63 - __builtin_clzll(v);
+        return (e - sub_bits + 1) * sub_count + (int)((v >> (e - sub_bits)) & (sub_count - 1));
+    }
+
+    static uint64_t lower_bound(int b)
+    {
+        if(b < sub_count)
+            return (uint64_t)b;
+        int e = b / sub_count + sub_bits - 1;
+        return (uint64_t)(sub_count + b % sub_count) << (e - sub_bits);
+    }
+
+    void record(uint64_t v)
+    {
+        if(buckets.empty())
+            buckets.resize(bucket_count);
+        ++buckets[(size_t)bucket(v)];
+        ++total;
+    }
+
+    uint64_t quantile(double q) const
+    {
+        if(total == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(q * (double)(total - 1));
+        uint64_t seen = 0;
+        for(int b = 0; b < bucket_count; ++b)
+            if((seen += buckets[(size_t)b]) > rank)
+                return lower_bound(b);
+        return lower_bound(bucket_count - 1);
+    }
+
+    void clear()
+    {
+        buckets.clear();
+        total = 0;
+    }
+};
+
+/**
+ * @struct window_tag
+ * @brief tells which window a customer stands at
+ *
+ * Customers point at the tag their window had when they joined. Closing a
+ * window hangs its tag under the tag of the window that takes the queue over,
+ * so the current window is found at the root, as in union-find.
+ */
+struct window_tag
+{
+    window_tag *parent; // nullptr for the current tag of a window
+    int window;
+    window_tag *next;   // next tag on the tag_list holding this one
+};
+
+/**
+ * @struct tag_list
+ * @brief singly linked list of tags, concatenated in O(1)
+ */
+struct tag_list
+{
+    window_tag *head = nullptr;
+    window_tag *tail = nullptr;
+
+    bool empty() const
+    { return !head; }
+
+    void push(window_tag *t)
+    {
+        t->next = head;
+        head = t;
+        if(!tail)
+            tail = t;
+    }
+
+    window_tag *pop()
+    {
+        window_tag *t = head;
+        head = t->next;
+        if(!head)
+            tail = nullptr;
+        return t;
+    }
+
+    // moves all tags of other to the end of this list
+    void append(tag_list &other)
+    {
+        if(other.empty())
+            return;
+        if(tail)
+            tail->next = other.head;
+        else
+            head = other.head;
+        tail = other.tail;
+        other = tag_list();
+    }
+};
+
+/**
+ * @struct window_heap
+ * @brief binary heap of window numbers ordered by keys[window], ties broken by
+ * the lower number, with the position of every window indexed for updates
+ */
+template <class Compare>
+struct window_heap
+{
+    const std::vector<int> *keys;
+    std::vector<int> heap;
+    std::vector<int> position; // -1 if the window is not in the heap
+
+    bool before(int a, int b) const
+    {
+        int ka = (*keys)[a], kb = (*keys)[b];
+        return Compare()(ka, kb) || (ka == kb && a < b);
+    }
+
+    bool contains(int k) const
+    { return k < (int)position.size() && position[k] >= 0; }
+
+    bool empty() const
+    { return heap.empty(); }
+
+    int top() const
+    { return heap.front(); }
+
+    void place(int i, int k)
+    {
+        heap[i] = k;
+        position[k] = i;
+    }
+
+    void sift_up(int i)
+    {
+        int k = heap[i];
+        while(i > 0 && before(k, heap[(i - 1) / 2]))
+        {
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, k);
+    }
+
+    void sift_down(int i)
+    {
+        int k = heap[i], n = (int)heap.size();
+        while(2 * i + 1 < n)
+        {
+            int c = 2 * i + 1;
+            if(c + 1 < n && before(heap[c + 1], heap[c]))
+                ++c;
+            if(!before(heap[c], k))
+                break;
+            place(i, heap[c]);
+            i = c;
+        }
+        place(i, k);
+    }
+
+    void insert(int k)
+    {
+        if(contains(k))
+            return;
+        if(k >= (int)position.size())
+            position.resize(k + 1, -1);
+        heap.push_back(k);
+        sift_up((int)heap.size() - 1);
+    }
+
+    void erase(int k)
+    {
+        if(!contains(k))
+            return;
+        int i = position[k];
+        position[k] = -1;
+        int last = heap.back();
+        heap.pop_back();
+        if(last == k)
+            return;
+        place(i, last);
+        sift_up(i);
+        sift_down(position[last]);
+    }
+
+    // restores the order after keys[k] changed
+    void update(int k)
+    {
+        if(!contains(k))
+            return;
+        sift_up(position[k]);
+        sift_down(position[k]);
+    }
 };
 
 /**
  * @struct city_hall
  * @brief represent a city hall with queues and a machine giving numbers
  * 
+ * Queues live in a deque, so opening a window never moves the existing ones.
+ * Slots of removed windows are kept in free_windows and handed out again;
+ * removed[k] tells whether window k is one of them.
+ * wait_times[k] holds wait times of customers served at window k, express
+ * those served by fast_track. Both are in clock ticks, converted to
+ * nanoseconds against steady_clock readings taken when measuring started.
+ * absorbed[k] holds the earlier tags whose root is now the tag of window k.
+ * Once queue k is empty no customer in any queue points at them, so they go
+ * to free_tags and are handed out again.
+ * lengths[k] is the length of queue k, kept up to date by every operation,
+ * shortest orders the windows open for routing by it and longest orders all
+ * windows that were not removed, to pick whom to steal from.
+ * waiters[k] are clerks suspended until a customer comes to window k. They are
+ * handed the customer, or nullptr when window k goes away or the office closes.
+ * closing_window is the window the resumable closing drains next, -1 if the
+ * office is not being closed.
+ * file is set when the queues live in a mapped file; the core operations are
+ * then forwarded to kol_plik, the rest of the hall stays empty and the
+ * operations that need it assert that no file is open.
  */
-struct city_hall: public std::vector<plib::list<interesant*>>
+struct city_hall: public std::deque<plib::list<interesant*>>
 {
-    using std::vector<plib::list<interesant*>>::vector;
+    using std::deque<plib::list<interesant*>>::deque;
     int counter;
+    std::vector<int> free_windows;
+    std::vector<bool> removed;
+
+    bool measuring;
+    uint64_t ticks_base;
+    std::chrono::steady_clock::time_point clock_base;
+    std::deque<latency_histogram> wait_times;
+    latency_histogram express;
+
+    std::deque<window_tag> tags; // stable storage of every tag ever made
+    tag_list free_tags;
+    std::vector<window_tag*> window_tags;
+    std::vector<tag_list> absorbed;
+    std::vector<int> lengths;
+    window_heap<std::less<int>> shortest{&lengths, {}, {}};
+    window_heap<std::greater<int>> longest{&lengths, {}, {}};
+
+    struct waiter
+    {
+        void (*resume)(void *, interesant *);
+        void *data;
+    };
+    std::vector<std::deque<waiter>> waiters;
+
+    int closing_window = -1;
+
+    kol_plik::hall *file = nullptr;
+
+    /**
+     * @brief prepares bookkeeping of a window that has just been created
+     */
+    void add_window()
+    {
+        window_tags.push_back(new_tag((int)window_tags.size()));
+        absorbed.emplace_back();
+        lengths.push_back(0);
+        removed.push_back(false);
+        shortest.insert((int)lengths.size() - 1);
+        longest.insert((int)lengths.size() - 1);
+        waiters.emplace_back();
+    }
+
+    /**
+     * @brief drops bookkeeping of the window with the highest number, whose
+     * queue has just been destroyed
+     */
+    void remove_last_window()
+    {
+        int k = (int)lengths.size() - 1;
+        shortest.erase(k);
+        longest.erase(k);
+        free_tags.append(absorbed[k]);
+        free_tags.push(window_tags[k]);
+        absorbed.pop_back();
+        window_tags.pop_back();
+        lengths.pop_back();
+        removed.pop_back();
+        waiters.pop_back();
+    }
+
+    window_tag *new_tag(int k)
+    {
+        window_tag *t;
+        if(free_tags.empty())
+        {
+            tags.emplace_back();
+            t = &tags.back();
+        }
+        else
+            t = free_tags.pop();
+        *t = {nullptr, k, nullptr};
+        return t;
+    }
+
+    /**
+     * @brief customers of window k1 now stand at window k2
+     */
+    void hang_tag(int k1, int k2)
+    {
+        window_tag *old = window_tags[k1];
+        old->parent = window_tags[k2];
+        absorbed[k2].push(old);
+        absorbed[k2].append(absorbed[k1]);
+        window_tags[k1] = new_tag(k1);
+    }
+
+    /**
+     * @brief resumes clerks waiting at window k while there are customers for them
+     *
+     * Each clerk is served its customer before it is resumed, so the loop
+     * never resumes more clerks than there are customers.
+     */
+    void wake(int k)
+    {
+        while(lengths[k] > 0 && !waiters[k].empty())
+        {
+            waiter w = waiters[k].front();
+            waiters[k].pop_front();
+            w.resume(w.data, obsluz(k));
+        }
+    }
+
+    /**
+     * @brief resumes every clerk waiting at window k without a customer
+     *
+     * The waiters are taken off first, so a window number handed out again
+     * later never resumes them.
+     */
+    void cancel_waiters(int k)
+    {
+        std::deque<waiter> cancelled;
+        cancelled.swap(waiters[k]);
+        for(const waiter &w : cancelled)
+            w.resume(w.data, nullptr);
+    }
+
+    /**
+     * @brief finds the window of a customer standing in some queue
+     *
+     * Time complexity amortized O(log m), nearly constant in practice
+     */
+    int window_of(interesant *i)
+    {
+        window_tag *t = i->tag;
+        while(t->parent)
+        {
+            if(t->parent->parent)
+                t->parent = t->parent->parent;
+            t = t->parent;
+        }
+        i->tag = t;
+        return t->window;
+    }
+
+    void resize_queue(int k, int by)
+    {
+        lengths[k] += by;
+        if(lengths[k] == 0)
+            free_tags.append(absorbed[k]);
+        shortest.update(k);
+        longest.update(k);
+    }
+
+    uint64_t now() const
+    { return measuring ? ticks() : 0; }
+
+    double to_ns(uint64_t t) const
+    {
+        uint64_t elapsed_ticks = ticks() - ticks_base;
+        auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - clock_base).count();
+        if(elapsed_ticks == 0 || elapsed_ns <= 0)
+            return (double)t;
+        return (double)t * (double)elapsed_ns / (double)elapsed_ticks;
+    }
 };
 
 static thread_local city_hall main_hall;
 
+/**
+ * @struct view_node
+ * @brief holds a published view; readers copy the shared_ptr out of it
+ */
+struct view_node
+{
+    std::shared_ptr<const widok_urzedu> view;
+};
+
+/**
+ * @struct view_reader
+ * @brief hazard slot of a thread reading published views
+ *
+ * A reader announces in hazard the node it is about to copy the view from, and
+ * the publisher frees a replaced node only once no slot announces it. Slots are
+ * never freed: a thread that exits gives its slot back for another reader.
+ */
+struct view_reader
+{
+    std::atomic<view_node*> hazard{nullptr};
+    std::atomic<bool> taken{true};
+    view_reader *next = nullptr;
+};
+
+/**
+ * @struct tablica_widokow
+ * @brief views published by one hall
+ *
+ * Only the hall's thread writes here; readers of any thread load current.
+ * Replaced nodes wait in retired until no reader announces them.
+ */
+struct tablica_widokow
+{
+    std::atomic<view_node*> current{nullptr};
+    unsigned long long version = 0;
+    std::vector<view_node*> retired;
+
+    ~tablica_widokow()
+    {
+        delete current.load();
+        for(view_node *n : retired)
+            delete n;
+    }
+};
+
+// hazard slots are shared by readers of all halls
+static std::atomic<view_reader*> view_readers{nullptr};
+
 void otwarcie_urzedu(int m)
-{ main_hall.resize(m); }
+{
+    assert(!main_hall.file);
+    int old = (int)main_hall.size();
+    for(int k = m; k < old; ++k)
+        main_hall.cancel_waiters(k);
+    main_hall.resize(m);
+    main_hall.wait_times.resize(m);
+    for(int k = old; k < m; ++k)
+        main_hall.add_window();
+    for(int k = old - 1; k >= m; --k)
+        main_hall.remove_last_window();
+    auto &free_windows = main_hall.free_windows;
+    free_windows.erase(std::remove_if(free_windows.begin(), free_windows.end(),
+                                      [m](int k) { return k >= m; }),
+                       free_windows.end());
+    dziennik_zapisz(operacja::otwarcie_urzedu, m);
+}
+
+bool otwarcie_urzedu_z_pliku(const char *plik, int m, int pojemnosc)
+{
+    // customers of the two engines must never meet in one hall
+    if(!main_hall.empty())
+        return false;
+
+    zamkniecie_pliku();
+    main_hall.file = kol_plik::open(plik, m, pojemnosc);
+    if(!main_hall.file)
+        return false;
+    dziennik_zapisz(operacja::otwarcie_urzedu, kol_plik::windows(main_hall.file));
+    return true;
+}
+
+interesant *interesant_o_numerku(int num)
+{
+    if(!main_hall.file)
+        return nullptr;
+    return kol_plik::by_number(main_hall.file, num);
+}
+
+void zamkniecie_pliku()
+{
+    if(main_hall.file)
+        kol_plik::close(main_hall.file);
+    main_hall.file = nullptr;
+}
+
+void pomiar_czasu(bool wlacz)
+{
+    assert(!main_hall.file);
+    if(wlacz && !main_hall.measuring)
+    {
+        main_hall.ticks_base = ticks();
+        main_hall.clock_base = std::chrono::steady_clock::now();
+    }
+    main_hall.measuring = wlacz;
+}
+
+double czas_oczekiwania(int k, double q)
+{
+    assert(!main_hall.file);
+    return main_hall.to_ns(main_hall.wait_times[k].quantile(q));
+}
+
+double czas_oczekiwania_ekspres(double q)
+{
+    assert(!main_hall.file);
+    return main_hall.to_ns(main_hall.express.quantile(q));
+}
+
+double czas_obslugi(interesant *i)
+{
+    assert(!main_hall.file);
+    if(i->arrived == 0 || i->served == 0)
+        return -1;
+    return main_hall.to_ns(i->served - i->arrived);
+}
+
+int otworz_okienko()
+{
+    assert(!main_hall.file);
+    dziennik_zapisz(operacja::otworz_okienko);
+    if(!main_hall.free_windows.empty())
+    {
+        int k = main_hall.free_windows.back();
+        main_hall.free_windows.pop_back();
+        assert(main_hall.removed[k]);
+        main_hall.removed[k] = false;
+        main_hall.wait_times[k].clear();
+        main_hall.shortest.insert(k);
+        main_hall.longest.insert(k);
+        return k;
+    }
+
+    main_hall.emplace_back();
+    main_hall.wait_times.emplace_back();
+    main_hall.add_window();
+    return (int)main_hall.size() - 1;
+}
+
+void usun_okienko(int k)
+{
+    assert(!main_hall.file);
+    assert(0 <= k && k < (int)main_hall.size() && !main_hall.removed[k]);
+    assert(main_hall[k].empty());
+    main_hall.removed[k] = true;
+    main_hall.free_windows.push_back(k);
+    main_hall.shortest.erase(k);
+    main_hall.longest.erase(k);
+    dziennik_zapisz(operacja::usun_okienko, k);
+    main_hall.cancel_waiters(k);
+}
 
 interesant *nowy_interesant(int k)
 {
+    if(main_hall.file)
+    {
+        // a full file gives nobody out, and the replica must not count them
+        interesant *out = kol_plik::nowy_interesant(main_hall.file, k);
+        if(out)
+            dziennik_zapisz(operacja::nowy_interesant, k);
+        return out;
+    }
+
     interesant* out = (interesant*)malloc(sizeof(interesant));
     out->num = main_hall.counter++;
     out->it = main_hall[k].push_back(out);
+    out->tag = main_hall.window_tags[k];
+    main_hall.shortest.insert(k);
+    main_hall.resize_queue(k, 1);
+    out->arrived = main_hall.now();
+    out->moved = 0;
+    out->served = 0;
+    dziennik_zapisz(operacja::nowy_interesant, k);
+    main_hall.wake(k);
     return out;
 }
 
+// clerks cannot wait at a file-backed hall, so its operations have nobody to wake
+void czekaj_na_interesanta(int k, void (*wznow)(void *, interesant *), void *dane)
+{
+    assert(!main_hall.file);
+    assert(0 <= k && k < (int)main_hall.size() && !main_hall.removed[k]);
+    main_hall.waiters[k].push_back({wznow, dane});
+}
+
+interesant *nowy_interesant_auto()
+{
+    assert(!main_hall.file);
+    assert(!main_hall.shortest.empty());
+    return nowy_interesant(main_hall.shortest.top());
+}
+
+// num is the first member of interesant and of a kol_plik node alike, so the
+// number is read the same way whichever engine gave the customer out
+static_assert(std::is_standard_layout<interesant>::value && offsetof(interesant, num) == 0,
+              "numerek reads num at the start of the customer");
+
 int numerek(interesant *i)
-{ return i->num; }
+{ return *reinterpret_cast<int*>(i); }
+
+int dlugosc_kolejki(int k)
+{
+    assert(!main_hall.file);
+    return main_hall.lengths[k];
+}
+
+/**
+ * @brief records that a customer who has just left a queue was served at window k
+ */
+static interesant *served_at(int k, interesant *out)
+{
+    if(main_hall.measuring && out->arrived)
+    {
+        out->served = ticks();
+        main_hall.wait_times[k].record(out->served - out->arrived);
+    }
+    return out;
+}
 
 interesant *obsluz(int k)
 {
+    if(main_hall.file)
+    {
+        interesant *out = kol_plik::obsluz(main_hall.file, k);
+        if(out)
+            dziennik_zapisz(operacja::obsluz, k);
+        return out;
+    }
+
+    if(main_hall[k].empty())
+        return nullptr;
+
+    interesant* out = main_hall[k].pop_front();
+    main_hall.resize_queue(k, -1);
+    dziennik_zapisz(operacja::obsluz, k);
+    return served_at(k, out);
+}
+
+interesant *obsluz_z_kradzieza(int k, kradziez polityka)
+{
+    assert(!main_hall.file);
     if(!main_hall[k].empty())
-        return main_hall[k].pop_front();
-    else
+        return obsluz(k);
+
+    if(main_hall.longest.empty())
+        return nullptr;
+    int victim = main_hall.longest.top();
+    if(main_hall.lengths[victim] == 0)
         return nullptr;
+
+    dziennik_zapisz(operacja::obsluz_z_kradzieza, k, (int)polityka);
+    auto& from = main_hall[victim];
+
+    if(polityka == kradziez::jeden)
+    {
+        main_hall.resize_queue(victim, -1);
+        return served_at(k, from.pop_back());
+    }
+
+    int moved = (main_hall.lengths[victim] + 1) / 2;
+    auto first = prev(from.end());
+    for(int j = 1; j < moved; ++j)
+        --first;
+    for(auto it = first; it != from.end(); ++it)
+        (*it)->tag = main_hall.window_tags[k];
+
+    main_hall[k].splice(main_hall[k].cend(), from, first);
+    main_hall.resize_queue(victim, -moved);
+    main_hall.shortest.insert(k);
+    main_hall.resize_queue(k, moved - 1);
+
+    interesant* out = served_at(k, main_hall[k].pop_front());
+    main_hall.wake(k);
+    return out;
 }
 
 void zmiana_okienka(interesant *i, int k)
 {
-    plib::list<interesant*>().erase(i->it);
+    if(main_hall.file)
+    {
+        dziennik_zapisz(operacja::zmiana_okienka, numerek(i), k);
+        return kol_plik::zmiana_okienka(main_hall.file, i, k);
+    }
+
+    main_hall.resize_queue(main_hall.window_of(i), -1);
+    plib::list<interesant*>::unlink(i->it);
     i->it = main_hall[k].push_back(i);
+    i->tag = main_hall.window_tags[k];
+    main_hall.shortest.insert(k);
+    main_hall.resize_queue(k, 1);
+    i->moved = main_hall.now();
+    dziennik_zapisz(operacja::zmiana_okienka, i->num, k);
+    main_hall.wake(k);
 }
 
 void zamkniecie_okienka(int k1, int k2)
-{ main_hall[k2].merge_back(main_hall[k1]); }
+{
+    if(main_hall.file)
+    {
+        dziennik_zapisz(operacja::zamkniecie_okienka, k1, k2);
+        return kol_plik::zamkniecie_okienka(main_hall.file, k1, k2);
+    }
+    if(k1 == k2)
+        return;
+
+    main_hall[k2].merge_back(main_hall[k1]);
+
+    // an empty queue leaves no customer behind to follow the old tag
+    int moved = main_hall.lengths[k1];
+    if(moved > 0)
+        main_hall.hang_tag(k1, k2);
+    main_hall.shortest.erase(k1);
+    main_hall.resize_queue(k1, -moved);
+    main_hall.resize_queue(k2, moved);
+    dziennik_zapisz(operacja::zamkniecie_okienka, k1, k2);
+    main_hall.wake(k2);
+}
 
 std::vector<interesant *> fast_track(interesant *i1, interesant *i2)
 {
+    if(main_hall.file)
+    {
+        dziennik_zapisz(operacja::fast_track, numerek(i1), numerek(i2));
+        return kol_plik::fast_track(main_hall.file, i1, i2);
+    }
+
+    dziennik_zapisz(operacja::fast_track, i1->num, i2->num);
+    int k = main_hall.window_of(i1);
     auto it = direct(i1->it, i2->it);
     std::vector<interesant*> out;
     
     while(it != i2->it)
     {
         out.push_back(*it);
-        it = plib::list<interesant*>().erase(it);
+        it = plib::list<interesant*>::unlink(it);
     }
 
     out.push_back(i2);
-    plib::list<interesant*>().erase(i2->it);
+    plib::list<interesant*>::unlink(i2->it);
+    main_hall.resize_queue(k, -(int)out.size());
+
+    if(main_hall.measuring)
+    {
+        uint64_t t = ticks();
+        for(interesant* i : out)
+            if(i->arrived)
+            {
+                i->served = t;
+                main_hall.express.record(t - i->arrived);
+            }
+    }
 
     return out;
 }
 
 void naczelnik(int k)
-{ main_hall[k].reverse(); }
+{
+    if(main_hall.file)
+    {
+        dziennik_zapisz(operacja::naczelnik, k);
+        return kol_plik::naczelnik(main_hall.file, k);
+    }
+
+    main_hall[k].reverse();
+    dziennik_zapisz(operacja::naczelnik, k);
+}
+
+void naczelnik_zakres(interesant *i1, interesant *i2)
+{
+    assert(!main_hall.file);
+    plib::list<interesant*>::reverse(direct(i1->it, i2->it), direct(i2->it, i1->it));
+    dziennik_zapisz(operacja::naczelnik_zakres, i1->num, i2->num);
+}
+
+void na_poczatek(interesant *i1, interesant *i2, int k)
+{
+    assert(!main_hall.file);
+    int from = main_hall.window_of(i1);
+    auto first = direct(i1->it, i2->it);
+
+    if(from != k)
+    {
+        int moved = 1;
+        for(auto it = first; it != i2->it; ++it, ++moved)
+            (*it)->tag = main_hall.window_tags[k];
+        i2->tag = main_hall.window_tags[k];
+
+        main_hall.resize_queue(from, -moved);
+        main_hall.shortest.insert(k);
+        main_hall.resize_queue(k, moved);
+    }
+
+    main_hall[k].splice(main_hall[k].cbegin(), first, direct(i2->it, i1->it));
+    dziennik_zapisz(operacja::na_poczatek, i1->num, i2->num, k);
+    main_hall.wake(k);
+}
+
+void obroc(int k, interesant *i)
+{
+    assert(!main_hall.file);
+    main_hall[k].rotate(direct(i->it, main_hall[k].cend()));
+    dziennik_zapisz(operacja::obroc, k, i->num);
+}
+
+/**
+ * @brief moves customers of the closing office to out, window by window
+ *
+ * Every taken customer and every passed window costs one unit of budget.
+ *
+ * @return true if all queues are empty
+ */
+static bool drain(long long budget, std::vector<interesant*> &out)
+{
+    int& k = main_hall.closing_window;
+    while(k < (int)main_hall.size() && budget > 0)
+    {
+        auto& queue = main_hall[k];
+        int taken = 0;
+        while(!queue.empty() && budget > 0)
+        {
+            out.push_back(queue.pop_front());
+            ++taken;
+            --budget;
+        }
+        main_hall.resize_queue(k, -taken);
+
+        if(!queue.empty())
+            return false;
+        ++k;
+        --budget;
+    }
+
+    if(k < (int)main_hall.size())
+        return false;
+    k = -1;
+    for(int w = 0; w < (int)main_hall.size(); ++w)
+        main_hall.cancel_waiters(w);
+    return true;
+}
 
 std::vector<interesant *> zamkniecie_urzedu()
 {
+    if(main_hall.file)
+    {
+        dziennik_zapisz(operacja::zamkniecie_urzedu);
+        return kol_plik::zamkniecie_urzedu(main_hall.file);
+    }
+
+    dziennik_zapisz(operacja::zamkniecie_urzedu);
     std::vector<interesant*> out;
+    main_hall.closing_window = 0;
+    drain(LLONG_MAX, out);
+    return out;
+}
+
+void zamykanie_start()
+{
+    assert(!main_hall.file);
+    dziennik_zapisz(operacja::zamykanie_start);
+    main_hall.closing_window = 0;
+}
+
+bool zamykanie_krok(int budzet, std::vector<interesant *> &out)
+{
+    assert(!main_hall.file && main_hall.closing_window >= 0 && budzet > 0);
+    dziennik_zapisz(operacja::zamykanie_krok, budzet);
+    return drain(budzet, out);
+}
+
+/**
+ * @brief returns the hazard slot of the calling thread, taking one on first use
+ */
+static view_reader *reader_slot()
+{
+    struct holder
+    {
+        view_reader *slot = nullptr;
+        ~holder()
+        {
+            if(slot)
+                slot->taken.store(false, std::memory_order_release);
+        }
+    };
+    static thread_local holder mine;
+    if(mine.slot)
+        return mine.slot;
+
+    for(view_reader *r = view_readers.load(std::memory_order_acquire); r; r = r->next)
+        if(!r->taken.load(std::memory_order_relaxed) && !r->taken.exchange(true, std::memory_order_acquire))
+            return mine.slot = r;
+
+    view_reader *r = new view_reader;
+    r->next = view_readers.load(std::memory_order_relaxed);
+    while(!view_readers.compare_exchange_weak(r->next, r, std::memory_order_release,
+                                              std::memory_order_relaxed))
+        ;
+    return mine.slot = r;
+}
+
+static thread_local tablica_widokow main_board;
+
+tablica_widokow *tablica_urzedu()
+{ return &main_board; }
+
+void opublikuj_widok()
+{
+    assert(!main_hall.file);
+    auto view = std::make_shared<widok_urzedu>();
+    view->wersja = ++main_board.version;
+    view->kolejki.reserve(main_hall.size());
+
     for(auto& queue : main_hall)
-        while(!queue.empty())
-            out.push_back(queue.pop_front());
+    {
+        view->kolejki.emplace_back();
+        for(interesant* i : queue)
+            view->kolejki.back().push_back(i->num);
+    }
+
+    view_node *old = main_board.current.exchange(new view_node{std::move(view)});
+    if(old)
+        main_board.retired.push_back(old);
+
+    // readers holding a copy keep their view alive, so a node only has to
+    // outlive the readers that are copying out of it right now
+    std::vector<view_node*> in_use;
+    for(view_reader *r = view_readers.load(); r; r = r->next)
+        if(view_node *n = r->hazard.load())
+            in_use.push_back(n);
+
+    auto unused = [&](view_node *n) {
+        if(std::find(in_use.begin(), in_use.end(), n) != in_use.end())
+            return false;
+        delete n;
+        return true;
+    };
+    auto& retired = main_board.retired;
+    retired.erase(std::remove_if(retired.begin(), retired.end(), unused), retired.end());
+}
+
+std::shared_ptr<const widok_urzedu> widok(const tablica_widokow *t)
+{
+    view_reader *me = reader_slot();
+    view_node *node;
+    do
+    {
+        node = t->current.load();
+        me->hazard.store(node);
+    }
+    while(node != t->current.load());
+
+    std::shared_ptr<const widok_urzedu> out;
+    if(node)
+        out = node->view;
+    me->hazard.store(nullptr, std::memory_order_release);
+    return out;
+}
+
+eksport_kolejek eksport()
+{
+    if(main_hall.file)
+        return kol_plik::eksport(main_hall.file);
+
+    eksport_kolejek out;
+    out.licznik = main_hall.counter;
+    out.poczatki.reserve(main_hall.size() + 1);
+
+    int k = 0;
+    for(auto& queue : main_hall)
+    {
+        out.poczatki.push_back((int)out.numerki.size());
+        for(interesant* i : queue)
+        {
+            out.numerki.push_back(i->num);
+            out.okienka.push_back(k);
+        }
+        ++k;
+    }
+    out.poczatki.push_back((int)out.numerki.size());
+
+    return out;
+}
+
+// four tickets at a time; GCC and Clang lower these to SSE/NEON at any -O
+typedef int ticket_lanes __attribute__((vector_size(4 * sizeof(int))));
+typedef long long sum_lanes __attribute__((vector_size(4 * sizeof(long long))));
+
+/**
+ * @brief min, max and sum of num[bgn, end) for a non-empty range
+ */
+static void reduce_tickets(const int *num, int bgn, int end, int &lo, int &hi, long long &sum)
+{
+    lo = INT_MAX;
+    hi = INT_MIN;
+    sum = 0;
+    int j = bgn;
+
+    if(end - bgn >= 4)
+    {
+        ticket_lanes v, lo4, hi4;
+        std::memcpy(&v, num + j, sizeof(v));
+        lo4 = hi4 = v;
+        sum_lanes sum4 = __builtin_convertvector(v, sum_lanes);
+
+        for(j += 4; j + 4 <= end; j += 4)
+        {
+            std::memcpy(&v, num + j, sizeof(v));
+            lo4 = v < lo4 ? v : lo4;
+            hi4 = v > hi4 ? v : hi4;
+            sum4 += __builtin_convertvector(v, sum_lanes);
+        }
+
+        for(int l = 0; l < 4; ++l)
+        {
+            lo = std::min(lo, lo4[l]);
+            hi = std::max(hi, hi4[l]);
+            sum += sum4[l];
+        }
+    }
+
+    for(; j < end; ++j)
+    {
+        lo = std::min(lo, num[j]);
+        hi = std::max(hi, num[j]);
+        sum += num[j];
+    }
+}
+
+std::vector<statystyki_okienka> statystyki(const eksport_kolejek &e)
+{
+    std::vector<statystyki_okienka> out(e.poczatki.size() - 1, {0, 0, 0, 0.0});
+
+    // each queue is a contiguous range of the export, reduced in one pass
+    for(size_t k = 0; k < out.size(); ++k)
+    {
+        int bgn = e.poczatki[k], end = e.poczatki[k + 1];
+        if(bgn == end)
+            continue;
+
+        int lo, hi;
+        long long sum;
+        reduce_tickets(e.numerki.data(), bgn, end, lo, hi, sum);
+
+        int cnt = end - bgn;
+        out[k].liczba = cnt;
+        out[k].min_wiek = e.licznik - hi;
+        out[k].max_wiek = e.licznik - lo;
+        out[k].sredni_wiek = e.licznik - (double)sum / cnt;
+    }
+
+    return out;
+}
+
+std::vector<int> histogram_wieku(const eksport_kolejek &e, int szerokosc,
+                                 int przedzialy)
+{
+    assert(szerokosc > 0 && przedzialy > 0);
+    std::vector<int> out((e.poczatki.size() - 1) * (size_t)przedzialy, 0);
+    const int* num = e.numerki.data();
+    const int* win = e.okienka.data();
+
+    // a scatter into the buckets, which no vector unit here does faster, so it
+    // stays a plain loop separate from the reductions of "statystyki"
+    for(size_t j = 0; j < e.numerki.size(); ++j)
+    {
+        int b = std::min((e.licznik - num[j]) / szerokosc, przedzialy - 1);
+        ++out[(size_t)win[j] * (size_t)przedzialy + (size_t)b];
+    }
 
     return out;
-}
\ No newline at end of file
+}
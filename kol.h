@@ -2,6 +2,7 @@
 #define KOL_H
 
 #include <vector>
+#include <memory>
 
 // Wszędzie w zadaniu można założyć, że wskaźniki przekazywane do funkcji są
 // wskaźnikami na struktury interesant, które były kiedyś wynikiem funkcji
@@ -20,6 +21,89 @@ struct interesant;
  */
 void otwarcie_urzedu(int m);
 
+/**
+ * @brief Inicjuje bibliotekę z kolejkami przechowywanymi w pliku
+ *
+ * Interesanci i kolejki leżą w pliku odwzorowanym w pamięć, powiązani
+ * przesunięciami zamiast wskaźników. Jeśli plik już istnieje, urząd jest
+ * podejmowany w stanie, w jakim go zostawiono, bez wczytywania danych; m i
+ * pojemnosc są wtedy ignorowane. Wcześniej wydanych interesantów można odzyskać
+ * przez "interesant_o_numerku".
+ *
+ * Na urzędzie w pliku działają "nowy_interesant", "numerek", "obsluz",
+ * "zmiana_okienka", "zamkniecie_okienka", "fast_track", "naczelnik",
+ * "zamkniecie_urzedu" i "eksport". Pozostałe funkcje, m.in. "dlugosc_kolejki",
+ * "otworz_okienko", pomiar czasu, "opublikuj_widok" i czekanie urzędników z
+ * kol_coro.h, wymagają urzędu w pamięci i sprawdzają to asercją. Wskaźników na
+ * interesantów nie wolno zwalniać; są ważne do wywołania "zamkniecie_pliku".
+ *
+ * Operacje trafiają do dziennika (dziennik.h) jak na urzędzie w pamięci, a
+ * otwarcie pliku jako "otwarcie_urzedu" z liczbą okienek z pliku. Replika
+ * odpowiada więc urzędowi głównemu tylko dla nowego pliku; po podjęciu
+ * istniejącego wykrywa lukę przy pierwszym nieznanym sobie interesancie.
+ *
+ * Pliku nie można otworzyć w wątku, w którym wywołano już "otwarcie_urzedu".
+ *
+ * @param plik nazwa pliku
+ * @param m liczba okienek nowego urzędu, dodatnia
+ * @param pojemnosc największa liczba interesantów nowego urzędu, nieujemna;
+ * po jej osiągnięciu "nowy_interesant" zwraca NULL. 2 * m + pojemnosc musi być
+ * mniejsze niż 2^32 - 1
+ * @return true jeśli się udało, false w przeciwnym przypadku, także gdy
+ * istniejący plik nie spełnia tych warunków
+ */
+
+bool otwarcie_urzedu_z_pliku(const char *plik, int m, int pojemnosc);
+
+/**
+ * @brief Zwraca interesanta urzędu w pliku o podanym numerku
+ *
+ * @param num numerek
+ * @return interesant* wskaźnik na interesanta lub NULL, jeśli takiego numerka
+ * jeszcze nie wydano albo żaden plik nie jest otwarty
+ */
+
+interesant *interesant_o_numerku(int num);
+
+/**
+ * @brief Zapisuje urząd do pliku i odłącza go
+ *
+ * Po wywołaniu pliku można użyć ponownie w "otwarcie_urzedu_z_pliku", także w
+ * innym procesie.
+ */
+
+void zamkniecie_pliku();
+
+/**
+ * @brief Otwiera nowe okienko w trakcie dnia
+ *
+ * Numer okienka usuniętego wcześniej przez "usun_okienko" może zostać użyty
+ * ponownie. Istniejące kolejki nie są przy tym przenoszone.
+ *
+ * Złożoność czasowa O(log m): kolejka powstaje w czasie stałym, a okienko
+ * trafia do kopców najkrótszej i najdłuższej kolejki
+ *
+ * @return int numer otwartego okienka
+ */
+
+int otworz_okienko();
+
+/**
+ * @brief Usuwa okienko k, zwalniając jego numer do ponownego użycia
+ *
+ * Zakładamy, że okienko k istnieje i nie zostało już usunięte, że kolejka do
+ * niego jest pusta (np. po wywołaniu "zamkniecie_okienka") i że do momentu
+ * ponownego otwarcia przez "otworz_okienko" nikt nie będzie się do niego
+ * ustawiał.
+ *
+ * Złożoność czasowa O(log m): kolejka jest zwalniana w czasie stałym, a okienko
+ * usuwane z kopców najkrótszej i najdłuższej kolejki
+ *
+ * @param k numer usuwanego okienka
+ */
+
+void usun_okienko(int k);
+
 /**
  * @brief Do urzędu przychodzi nowy interesant
  *
@@ -29,6 +113,33 @@ void otwarcie_urzedu(int m);
 
 interesant *nowy_interesant(int k);
 
+/**
+ * @brief Do urzędu przychodzi nowy interesant i ustawia się do okienka z
+ * najkrótszą kolejką
+ *
+ * Spośród okienek o tej samej długości kolejki wybierane jest to o najmniejszym
+ * numerze. Nie są brane pod uwagę okienka usunięte przez "usun_okienko" ani
+ * zamknięte przez "zamkniecie_okienka", dopóki ktoś nie ustawi się do nich
+ * jawnie. Zakładamy, że jest co najmniej jedno okienko branego pod uwagę.
+ *
+ * Złożoność czasowa O(log m)
+ *
+ * @return interesant* wskaźnik na strukturę nowego interesanta
+ */
+
+interesant *nowy_interesant_auto();
+
+/**
+ * @brief Zwraca liczbę interesantów stojących w kolejce do okienka k
+ *
+ * Złożoność czasowa O(1)
+ *
+ * @param k numer okienka
+ * @return int długość kolejki
+ */
+
+int dlugosc_kolejki(int k);
+
 /**
  * @brief Zwraca numerek interesanta
  *
@@ -53,6 +164,34 @@ int numerek(interesant *i);
 
 interesant *obsluz(int k);
 
+/**
+ * @brief Sposoby przejmowania interesantów przez bezczynne okienko
+ */
+enum class kradziez
+{
+    jeden,  // obsługiwany jest ostatni interesant najdłuższej kolejki
+    polowa  // tylna połowa najdłuższej kolejki (zaokrąglona w górę) przechodzi
+            // do okienka w tej samej kolejności i obsługiwany jest pierwszy z nich
+};
+
+/**
+ * @brief Obsługuje jednego interesanta, a jeśli kolejka do okienka k jest
+ * pusta, przejmuje interesantów z końca najdłuższej kolejki
+ *
+ * Spośród kolejek o tej samej długości wybierana jest ta o najmniejszym numerze
+ * okienka. Najdłuższa kolejka jest znana bez przeglądania okienek.
+ *
+ * Złożoność czasowa O(log m) dla "kradziez::jeden", O(log m + liczba
+ * przejętych) dla "kradziez::polowa"
+ *
+ * @param k numer okienka przy którym obsługiwany jest interesant
+ * @param polityka ilu interesantów przejąć
+ * @return interesant* obsłużony interesant lub NULL jeśli wszystkie kolejki
+ * były puste
+ */
+
+interesant *obsluz_z_kradzieza(int k, kradziez polityka = kradziez::jeden);
+
 /**
  * @brief Interesant i ustawia się w kolejce do okienka k
  *
@@ -97,6 +236,53 @@ std::vector<interesant *> fast_track(interesant *i1, interesant *i2);
 
 void naczelnik(int k);
 
+/**
+ * @brief Naczelnik odwraca kolejność interesantów od i1 do i2
+ *
+ * Zakładamy, że i1 oraz i2 stoją w tej samej kolejce oraz że i1 stoi w kolejce
+ * przed i2, chyba że i1 == i2. Pozostali interesanci nie zmieniają miejsc.
+ *
+ * Złożoność czasowa O(odległość między i1 a i2); samo przepięcie kolejki
+ * zajmuje czas stały
+ *
+ * @param i1 Pierwszy interesant odwracanego fragmentu
+ * @param i2 Ostatni interesant odwracanego fragmentu
+ */
+
+void naczelnik_zakres(interesant *i1, interesant *i2);
+
+/**
+ * @brief Interesanci od i1 do i2 przechodzą na początek kolejki do okienka k,
+ * zachowując swoją kolejność
+ *
+ * Zakładamy, że i1 oraz i2 stoją w tej samej kolejce oraz że i1 stoi w kolejce
+ * przed i2, chyba że i1 == i2. Okienko k może być tym, do którego już stoją.
+ *
+ * Złożoność czasowa O(odległość między i1 a i2); samo przepięcie kolejki
+ * zajmuje czas stały
+ *
+ * @param i1 Pierwszy przechodzący interesant
+ * @param i2 Ostatni przechodzący interesant
+ * @param k numer okienka, na którego początek przechodzą
+ */
+
+void na_poczatek(interesant *i1, interesant *i2, int k);
+
+/**
+ * @brief Kolejka do okienka k zostaje obrócona tak, że interesant i staje na
+ * jej początku, a stojący przed nim przechodzą w tej samej kolejności na koniec
+ *
+ * Zakładamy, że i stoi w kolejce do okienka k.
+ *
+ * Złożoność czasowa O(długość kolejki); samo przepięcie kolejki zajmuje czas
+ * stały
+ *
+ * @param k numer okienka
+ * @param i interesant, który staje na początku kolejki
+ */
+
+void obroc(int k, interesant *i);
+
 /**
  * @brief Zamyka urząd
  *
@@ -106,4 +292,205 @@ void naczelnik(int k);
 
 std::vector<interesant *> zamkniecie_urzedu();
 
+/**
+ * @brief Zaczyna zamykanie urzędu po kawałku
+ *
+ * Kolejne wywołania "zamykanie_krok" oddają interesantów w tym samym porządku
+ * co "zamkniecie_urzedu". Do zakończenia zamykania wolno jedynie odczytywać
+ * stan urzędu, np. przez "numerek" czy "dlugosc_kolejki".
+ */
+
+void zamykanie_start();
+
+/**
+ * @brief Oddaje kolejnych interesantów zamykanego urzędu
+ *
+ * Każdy oddany interesant i każde opróżnione okienko zużywają jedną jednostkę
+ * budżetu, więc czas jednego kroku zależy od budżetu, a nie od wielkości urzędu.
+ *
+ * Złożoność czasowa O(budzet * log m)
+ *
+ * @param budzet dodatnia liczba jednostek pracy na ten krok
+ * @param out wektor, na którego koniec trafiają interesanci, uporządkowani wg
+ * numeru okienka i następnie porządku kolejki
+ * @return true jeśli wszystkie kolejki są już puste i zamykanie się skończyło
+ */
+
+bool zamykanie_krok(int budzet, std::vector<interesant *> &out);
+
+/**
+ * @brief Włącza lub wyłącza pomiar czasu
+ *
+ * Gdy pomiar jest włączony, zapisywane są chwile przyjścia, zmiany okienka i
+ * obsłużenia interesanta, a czasy oczekiwania obsłużonych interesantów trafiają
+ * do estymatorów kwantyli: osobnego dla każdego okienka i jednego dla okienka
+ * specjalnego z "fast_track". Do estymatorów trafiają tylko interesanci, którzy
+ * przyszli przy włączonym pomiarze.
+ *
+ * @param wlacz true, aby włączyć pomiar
+ */
+
+void pomiar_czasu(bool wlacz);
+
+/**
+ * @brief Zwraca kwantyl czasu oczekiwania interesantów obsłużonych przy
+ * okienku k
+ *
+ * Wynik jest przybliżony z błędem względnym nie większym niż 1/16.
+ *
+ * @param k numer okienka
+ * @param q rząd kwantyla z przedziału [0, 1], np. 0.5, 0.99 lub 0.999
+ * @return double czas oczekiwania w nanosekundach lub 0, jeśli nikogo nie
+ * obsłużono
+ */
+
+double czas_oczekiwania(int k, double q);
+
+/**
+ * @brief Zwraca kwantyl czasu oczekiwania interesantów obsłużonych przez
+ * "fast_track"
+ *
+ * @param q rząd kwantyla z przedziału [0, 1]
+ * @return double czas oczekiwania w nanosekundach lub 0, jeśli nikogo nie
+ * obsłużono
+ */
+
+double czas_oczekiwania_ekspres(double q);
+
+/**
+ * @brief Zwraca czas, jaki interesant i czekał na obsłużenie
+ *
+ * @param i wskaźnik na interesanta
+ * @return double czas oczekiwania w nanosekundach lub -1, jeśli interesant nie
+ * został obsłużony albo nie był mierzony
+ */
+
+double czas_obslugi(interesant *i);
+
+/**
+ * @brief Niezmienny obraz wszystkich kolejek
+ *
+ * kolejki[k] to numerki interesantów stojących do okienka k w kolejności
+ * kolejki. Obraz nie zmienia się, dopóki ktoś go trzyma, niezależnie od
+ * dalszych operacji na urzędzie.
+ */
+struct widok_urzedu
+{
+    unsigned long long wersja; // kolejne publikacje mają rosnące wersje
+    std::vector<std::vector<int>> kolejki;
+};
+
+struct tablica_widokow;
+
+/**
+ * @brief Zwraca tablicę, na której urząd wywołującego wątku publikuje obrazy
+ *
+ * Wątek urzędu przekazuje ją czytelnikom. Tablica istnieje do zakończenia
+ * wątku urzędu; czytelnicy muszą wcześniej przestać z niej czytać.
+ *
+ * @return tablica_widokow* tablica urzędu tego wątku
+ */
+
+tablica_widokow *tablica_urzedu();
+
+/**
+ * @brief Publikuje obraz obecnego stanu kolejek dla czytelników
+ *
+ * Wywołuje ją wątek obsługujący urząd, a obraz trafia na tablicę jego urzędu.
+ * Nie czeka na czytelników. Poprzednio opublikowany obraz zostaje zwolniony,
+ * gdy przestanie go trzymać ostatni czytelnik.
+ *
+ * Złożoność czasowa O(m + liczba stojących interesantów)
+ */
+
+void opublikuj_widok();
+
+/**
+ * @brief Zwraca ostatnio opublikowany obraz kolejek
+ *
+ * Można ją wywoływać z dowolnego wątku, równolegle z operacjami na urzędzie
+ * i z "opublikuj_widok". Nie używa blokad, więc liczba czytelników nie
+ * spowalnia wątku obsługującego urząd.
+ *
+ * @param t tablica urzędu zwrócona przez "tablica_urzedu"
+ * @return std::shared_ptr<const widok_urzedu> obraz kolejek lub nullptr, jeśli
+ * niczego jeszcze nie opublikowano
+ */
+
+std::shared_ptr<const widok_urzedu> widok(const tablica_widokow *t);
+
+/**
+ * @brief Stan wszystkich kolejek zapisany w postaci ciągłych tablic
+ *
+ * j-ty interesant eksportu ma numerek numerki[j] i stoi w kolejce do okienka
+ * okienka[j]. Interesanci są uporządkowani wg numeru okienka i następnie
+ * porządku kolejki, więc kolejka do okienka k zajmuje przedział
+ * [poczatki[k], poczatki[k + 1]).
+ *
+ * Wiekiem interesanta nazywamy licznik - numerek, czyli liczbę numerków
+ * wydanych od jego przyjścia.
+ */
+struct eksport_kolejek
+{
+    int licznik;               // numerek, który dostanie następny interesant
+    std::vector<int> numerki;
+    std::vector<int> okienka;
+    std::vector<int> poczatki; // rozmiar: liczba okienek + 1
+};
+
+/**
+ * @brief Statystyki wieku interesantów w kolejce do jednego okienka
+ *
+ * Dla pustej kolejki wszystkie pola są równe 0.
+ */
+struct statystyki_okienka
+{
+    int liczba;
+    int min_wiek;
+    int max_wiek;
+    double sredni_wiek;
+};
+
+/**
+ * @brief Eksportuje stan wszystkich kolejek
+ *
+ * Złożoność czasowa O(m + liczba stojących interesantów)
+ *
+ * @return eksport_kolejek kopia stanu kolejek w postaci tablic
+ */
+
+eksport_kolejek eksport();
+
+/**
+ * @brief Liczy dla każdego okienka liczbę czekających oraz minimalny,
+ * maksymalny i średni wiek interesanta
+ *
+ * Przechodzi raz po ciągłych tablicach eksportu, bez odwołań do kolejek.
+ * Minimum, maksimum i suma numerków są liczone instrukcjami wektorowymi, po
+ * cztery numerki naraz, niezależnie od poziomu optymalizacji kompilatora.
+ *
+ * @param e eksport kolejek
+ * @return std::vector<statystyki_okienka> statystyki, indeksowane numerem
+ * okienka
+ */
+
+std::vector<statystyki_okienka> statystyki(const eksport_kolejek &e);
+
+/**
+ * @brief Liczy histogram wieku interesantów dla każdego okienka
+ *
+ * Przedział b obejmuje wieki [b * szerokosc, (b + 1) * szerokosc), a ostatni
+ * przedział dodatkowo wszystkie większe. Histogram jest liczony osobnym
+ * przejściem po eksporcie, bez instrukcji wektorowych.
+ *
+ * @param e eksport kolejek
+ * @param szerokosc szerokość przedziału, dodatnia
+ * @param przedzialy liczba przedziałów, dodatnia
+ * @return std::vector<int> liczności; przedział b okienka k ma indeks
+ * k * przedzialy + b
+ */
+
+std::vector<int> histogram_wieku(const eksport_kolejek &e, int szerokosc,
+                                 int przedzialy);
+
 #endif
@@ -0,0 +1,79 @@
+#ifndef KOL_CORO_H
+#define KOL_CORO_H
+
+/**
+ * @file kol_coro.h
+ * @brief clerks waiting for customers without polling "obsluz"
+ */
+
+#include "kol.h"
+
+/**
+ * @brief Zapisuje urzędnika czekającego na interesanta przy okienku k
+ *
+ * Gdy do okienka k trafi interesant ("nowy_interesant", "zmiana_okienka",
+ * "zamkniecie_okienka", "na_poczatek" lub "obsluz_z_kradzieza"), urzędnicy są
+ * wznawiani w kolejności zapisania, po jednym na każdego interesanta, przez
+ * wywołanie wznow(dane, i) na końcu tej operacji, gdzie i to interesant
+ * obsłużony już dla nich przez "obsluz(k)".
+ *
+ * Gdy okienko k zostaje usunięte ("usun_okienko" lub "otwarcie_urzedu" z
+ * mniejszą liczbą okienek) albo urząd zamknięty ("zamkniecie_urzedu" lub
+ * ostatnie "zamykanie_krok"), czekający przy nim są wznawiani przez
+ * wznow(dane, NULL) i przestają być zapisani, więc okienko o tym samym numerze
+ * otwarte później ich nie wznowi. Dopiero wtedy wolno zwolnić dane.
+ *
+ * Czekający są związani z urzędem wątku, który ich zapisał.
+ *
+ * Złożoność czasowa O(1)
+ *
+ * @param k numer otwartego okienka
+ * @param wznow funkcja wznawiająca urzędnika
+ * @param dane argument dla wznow
+ */
+
+void czekaj_na_interesanta(int k, void (*wznow)(void *, interesant *), void *dane);
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+
+/**
+ * @brief Urzędnik czeka na następnego interesanta przy okienku k
+ *
+ * "co_await nastepny(k)" zwraca interesanta obsłużonego przy okienku k. Jeśli
+ * kolejka jest pusta, korutyna zostaje uśpiona i wznowiona bezpośrednio przez
+ * operację, która przyprowadzi do okienka interesanta. Jeśli zamiast tego
+ * okienko zostanie usunięte albo urząd zamknięty, "co_await" zwraca NULL.
+ * Uśpionej korutyny nie wolno zniszczyć przed jednym z tych zdarzeń.
+ */
+struct nastepny
+{
+    int k;
+    bool uspiony = false;
+    interesant *obsluzony = nullptr;
+    std::coroutine_handle<> h;
+
+    explicit nastepny(int okienko) : k(okienko)
+    { }
+
+    bool await_ready() const
+    { return dlugosc_kolejki(k) > 0; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        uspiony = true;
+        h = handle;
+        czekaj_na_interesanta(k, [](void *p, interesant *i) {
+            nastepny *n = static_cast<nastepny *>(p);
+            n->obsluzony = i;
+            n->h.resume();
+        }, this);
+    }
+
+    interesant *await_resume()
+    { return uspiony ? obsluzony : obsluz(k); }
+};
+
+#endif
+
+#endif
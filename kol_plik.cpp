@@ -0,0 +1,316 @@
+/**
+ * @file kol_plik.cpp
+ * @brief city hall stored in a memory-mapped file
+ *
+ * File layout: a header, m window records, then the node array. Nodes 2k and
+ * 2k + 1 are the guardians of window k, node 2m + j is the customer with
+ * number j. Links are node indices, nil marks the missing neighbour of a
+ * guardian. The file is created sparse with room for all customers up front,
+ * so it never has to be remapped while the hall is open.
+ */
+
+#include "kol_plik.h"
+#include "kol.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kol_plik
+{
+    namespace
+    {
+        constexpr uint64_t file_magic = 0x6b6f6c706c696b31; // "kolplik1"
+        constexpr uint32_t nil = UINT32_MAX;
+
+        struct file_node
+        {
+            int32_t num;      // -1 for guardians
+            uint32_t next[2]; // neighbours in the queue in arbitrary order
+        };
+
+        // kol.cpp reads the number of any customer as the int it starts with
+        static_assert(std::is_standard_layout<file_node>::value && offsetof(file_node, num) == 0
+                      && std::is_same<int32_t, int>::value,
+                      "a node has to start with the customer's number");
+
+        struct file_window
+        {
+            uint32_t before_first; // guardian of begin
+            uint32_t past_last;    // guardian of end
+        };
+
+        struct file_header
+        {
+            uint64_t magic;
+            int32_t windows;
+            int32_t capacity;
+            int32_t counter; // number of the next customer
+            int32_t padding;
+        };
+
+        // every node index, customers included, has to stay below nil
+        bool valid_shape(int m, int capacity)
+        {
+            return m > 0 && capacity >= 0 && 2 * (uint64_t)m + (uint64_t)capacity < nil;
+        }
+
+        size_t file_size(int m, int capacity)
+        {
+            return sizeof(file_header) + (size_t)m * sizeof(file_window)
+                 + (2 * (size_t)m + (size_t)capacity) * sizeof(file_node);
+        }
+    }
+
+    struct hall
+    {
+        void *mapping;
+        size_t size;
+        file_header *header;
+        file_window *windows;
+        file_node *nodes;
+
+        file_node &operator[](uint32_t j)
+        { return nodes[j]; }
+
+        uint32_t index(interesant *i) const
+        { return (uint32_t)((file_node*)i - nodes); }
+
+        interesant *customer(uint32_t j)
+        { return (interesant*)&nodes[j]; }
+
+        // the neighbour of j which is not from
+        uint32_t other(uint32_t j, uint32_t from)
+        { return nodes[j].next[0] == from ? nodes[j].next[1] : nodes[j].next[0]; }
+
+        // in j, the link to from is replaced by a link to to
+        void relink(uint32_t j, uint32_t from, uint32_t to)
+        { nodes[j].next[nodes[j].next[0] == from ? 0 : 1] = to; }
+
+        uint32_t first(int k)
+        { return other(windows[k].before_first, nil); }
+
+        uint32_t last(int k)
+        { return other(windows[k].past_last, nil); }
+
+        void push_back(int k, uint32_t j)
+        {
+            uint32_t end = windows[k].past_last, prev = last(k);
+            relink(prev, end, j);
+            relink(end, prev, j);
+            nodes[j].next[0] = prev;
+            nodes[j].next[1] = end;
+        }
+
+        void unlink(uint32_t j)
+        {
+            uint32_t a = nodes[j].next[0], b = nodes[j].next[1];
+            relink(a, j, b);
+            relink(b, j, a);
+            nodes[j].next[0] = nodes[j].next[1] = nil;
+        }
+    };
+
+    hall *open(const char *path, int m, int capacity)
+    {
+        int fd = ::open(path, O_RDWR | O_CREAT, 0600);
+        if(fd < 0)
+            return nullptr;
+
+        struct stat st;
+        bool fresh = fstat(fd, &st) == 0 && st.st_size == 0;
+        if(fresh)
+        {
+            if(!valid_shape(m, capacity) || ftruncate(fd, (off_t)file_size(m, capacity)) != 0)
+            {
+                ::close(fd);
+                return nullptr;
+            }
+        }
+        else
+        {
+            file_header h;
+            if(pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || h.magic != file_magic
+               || !valid_shape(h.windows, h.capacity) || h.counter < 0 || h.counter > h.capacity
+               || (size_t)st.st_size < file_size(h.windows, h.capacity))
+            {
+                ::close(fd);
+                return nullptr;
+            }
+            m = h.windows;
+            capacity = h.capacity;
+        }
+
+        size_t size = file_size(m, capacity);
+        void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+            return nullptr;
+
+        char *bytes = (char*)mapping;
+        hall *h = new hall{mapping, size, (file_header*)bytes,
+                           (file_window*)(bytes + sizeof(file_header)),
+                           (file_node*)(bytes + sizeof(file_header) + (size_t)m * sizeof(file_window))};
+
+        if(fresh)
+        {
+            for(int k = 0; k < m; ++k)
+            {
+                uint32_t b = 2 * (uint32_t)k, e = b + 1;
+                h->windows[k] = {b, e};
+                h->nodes[b] = {-1, {e, nil}};
+                h->nodes[e] = {-1, {b, nil}};
+            }
+            h->header->windows = m;
+            h->header->capacity = capacity;
+            h->header->counter = 0;
+            // the magic goes last, so a half-initialized file is never accepted
+            h->header->magic = file_magic;
+        }
+
+        return h;
+    }
+
+    void close(hall *h)
+    {
+        msync(h->mapping, h->size, MS_SYNC);
+        munmap(h->mapping, h->size);
+        delete h;
+    }
+
+    int windows(hall *h)
+    { return h->header->windows; }
+
+    interesant *nowy_interesant(hall *h, int k)
+    {
+        if(h->header->counter >= h->header->capacity)
+            return nullptr;
+
+        int num = h->header->counter++;
+        uint32_t j = 2 * (uint32_t)h->header->windows + (uint32_t)num;
+        (*h)[j].num = num;
+        h->push_back(k, j);
+        return h->customer(j);
+    }
+
+    interesant *obsluz(hall *h, int k)
+    {
+        uint32_t j = h->first(k);
+        if(j == h->windows[k].past_last)
+            return nullptr;
+
+        h->unlink(j);
+        return h->customer(j);
+    }
+
+    void zmiana_okienka(hall *h, interesant *i, int k)
+    {
+        uint32_t j = h->index(i);
+        h->unlink(j);
+        h->push_back(k, j);
+    }
+
+    void zamkniecie_okienka(hall *h, int k1, int k2)
+    {
+        if(k1 == k2 || h->first(k1) == h->windows[k1].past_last)
+            return;
+
+        uint32_t bgn1 = h->windows[k1].before_first, end1 = h->windows[k1].past_last;
+        uint32_t first1 = h->first(k1), last1 = h->last(k1);
+        uint32_t end2 = h->windows[k2].past_last, last2 = h->last(k2);
+
+        h->relink(last2, end2, first1);
+        h->relink(first1, bgn1, last2);
+        h->relink(last1, end1, end2);
+        h->relink(end2, last2, last1);
+        h->relink(bgn1, first1, end1);
+        h->relink(end1, last1, bgn1);
+    }
+
+    std::vector<interesant *> fast_track(hall *h, interesant *i1, interesant *i2)
+    {
+        uint32_t from = h->index(i1), to = h->index(i2);
+
+        // walk both ways at once, like plib's direct, to learn which way i2 is
+        uint32_t guardians = 2 * (uint32_t)h->header->windows;
+        int way = 0;
+        if(from != to)
+        {
+            uint32_t prev[2] = {from, from};
+            uint32_t cur[2] = {(*h)[from].next[0], (*h)[from].next[1]};
+            while(cur[0] != to && cur[1] != to)
+                for(int w = 0; w < 2; ++w)
+                    if(cur[w] >= guardians)
+                    {
+                        uint32_t nxt = h->other(cur[w], prev[w]);
+                        prev[w] = cur[w];
+                        cur[w] = nxt;
+                    }
+            way = cur[0] == to ? 0 : 1;
+        }
+
+        std::vector<interesant*> out;
+        uint32_t j = from, next = (*h)[from].next[way];
+        while(true)
+        {
+            out.push_back(h->customer(j));
+            if(j == to)
+                break;
+            uint32_t after = h->other(next, j);
+            j = next;
+            next = after;
+        }
+
+        for(interesant *i : out)
+            h->unlink(h->index(i));
+        return out;
+    }
+
+    void naczelnik(hall *h, int k)
+    { std::swap(h->windows[k].before_first, h->windows[k].past_last); }
+
+    std::vector<interesant *> zamkniecie_urzedu(hall *h)
+    {
+        std::vector<interesant*> out;
+        for(int k = 0; k < h->header->windows; ++k)
+            while(interesant *i = obsluz(h, k))
+                out.push_back(i);
+        return out;
+    }
+
+    eksport_kolejek eksport(hall *h)
+    {
+        eksport_kolejek out;
+        out.licznik = h->header->counter;
+        out.poczatki.reserve((size_t)h->header->windows + 1);
+
+        for(int k = 0; k < h->header->windows; ++k)
+        {
+            out.poczatki.push_back((int)out.numerki.size());
+            uint32_t prev = h->windows[k].before_first, end = h->windows[k].past_last;
+            for(uint32_t j = h->first(k); j != end; )
+            {
+                out.numerki.push_back((*h)[j].num);
+                out.okienka.push_back(k);
+                uint32_t next = h->other(j, prev);
+                prev = j;
+                j = next;
+            }
+        }
+        out.poczatki.push_back((int)out.numerki.size());
+
+        return out;
+    }
+
+    interesant *by_number(hall *h, int num)
+    {
+        if(num < 0 || num >= h->header->counter)
+            return nullptr;
+        return h->customer(2 * (uint32_t)h->header->windows + (uint32_t)num);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+/**
+ * @file kol_plik.h
+ * @brief city hall stored in a memory-mapped file, used by kol.cpp when the
+ * office is opened with otwarcie_urzedu_z_pliku
+ */
+
+#include <vector>
+
+struct interesant;
+struct eksport_kolejek;
+
+/**
+ * @namespace kol_plik
+ * @brief file-backed storage engine
+ *
+ * Customers and window guardians are nodes of one array in the file, linked by
+ * node indices instead of pointers, so the file can be mapped at any address.
+ * As in plib::list, a node keeps its two neighbours in arbitrary order, which
+ * makes reversing a queue O(1). An interesant* handed out by this engine points
+ * at its node inside the mapping and stays valid until the file is closed. A
+ * node starts with the customer's number, like interesant, so numerek needs no
+ * forwarding here.
+ */
+namespace kol_plik
+{
+    struct hall;
+
+    /**
+     * @brief maps an existing hall file or creates a new one
+     *
+     * @param path file name
+     * @param m number of windows of a new hall, ignored when the file exists
+     * @param capacity maximal number of customers of a new hall, ignored when the file exists
+     * @return hall* the mapped hall or nullptr on failure
+     */
+    hall *open(const char *path, int m, int capacity);
+
+    /**
+     * @brief flushes the mapping to the file and unmaps it
+     */
+    void close(hall *h);
+
+    /**
+     * @brief number of windows of the hall
+     */
+    int windows(hall *h);
+
+    interesant *nowy_interesant(hall *h, int k);
+    interesant *obsluz(hall *h, int k);
+    void zmiana_okienka(hall *h, interesant *i, int k);
+    void zamkniecie_okienka(hall *h, int k1, int k2);
+    std::vector<interesant *> fast_track(hall *h, interesant *i1, interesant *i2);
+    void naczelnik(hall *h, int k);
+    std::vector<interesant *> zamkniecie_urzedu(hall *h);
+    eksport_kolejek eksport(hall *h);
+
+    /**
+     * @brief finds the customer with the given number, e.g. after remapping the file
+     *
+     * @return interesant* the customer or nullptr if no such number was given out
+     */
+    interesant *by_number(hall *h, int num);
+}
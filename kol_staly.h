@@ -0,0 +1,166 @@
+#ifndef KOL_STALY_H
+#define KOL_STALY_H
+
+/**
+ * @file kol_staly.h
+ * @brief city hall with a number of windows fixed at compile time
+ */
+
+#include "plist.h"
+#include "interesant.h"
+#include "kol.h"
+#include <array>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+
+// Urząd o M okienkach znanych w czasie kompilacji. Kolejki leżą w std::array
+// wewnątrz obiektu urzędu przekazywanego jawnie, więc nie ma odwołań do
+// zmiennej thread_local, a numery okienek podane jako argumenty szablonu są
+// sprawdzane przez kompilator. Operacje działają jak ich odpowiedniki z kol.h;
+// urząd nie mierzy czasu, nie publikuje widoków ani dziennika. Numerek
+// odczytuje metoda "numerek", bez odwołania do urzędu z kol.cpp. Urzędu nie
+// można kopiować, bo interesanci wskazują na miejsca w jego kolejkach; można
+// go przenieść.
+
+namespace kol
+{
+    /**
+     * @struct city_hall
+     * @brief represent a city hall with M queues and a machine giving numbers
+     * @tparam M number of windows
+     */
+    template <int M>
+    struct city_hall: public std::array<plib::list<interesant*>, M>
+    {
+        static_assert(M > 0, "a city hall needs at least one window");
+
+        int counter = 0;
+
+        city_hall() = default;
+        city_hall(const city_hall&) = delete;
+        city_hall(city_hall&&) = default;
+        city_hall& operator=(const city_hall&) = delete;
+        city_hall& operator=(city_hall&&) = default;
+
+        static int numerek(interesant *i)
+        { return i->num; }
+
+        interesant *nowy_interesant(int k);
+        interesant *obsluz(int k);
+        void zmiana_okienka(interesant *i, int k);
+        void zamkniecie_okienka(int k1, int k2);
+        std::vector<interesant *> fast_track(interesant *i1, interesant *i2);
+        void naczelnik(int k);
+        std::vector<interesant *> zamkniecie_urzedu();
+
+        template <int k>
+        interesant *nowy_interesant()
+        {
+            static_assert(0 <= k && k < M, "no such window");
+            return nowy_interesant(k);
+        }
+
+        template <int k>
+        interesant *obsluz()
+        {
+            static_assert(0 <= k && k < M, "no such window");
+            return obsluz(k);
+        }
+
+        template <int k>
+        void zmiana_okienka(interesant *i)
+        {
+            static_assert(0 <= k && k < M, "no such window");
+            zmiana_okienka(i, k);
+        }
+
+        template <int k1, int k2>
+        void zamkniecie_okienka()
+        {
+            static_assert(0 <= k1 && k1 < M && 0 <= k2 && k2 < M, "no such window");
+            zamkniecie_okienka(k1, k2);
+        }
+
+        template <int k>
+        void naczelnik()
+        {
+            static_assert(0 <= k && k < M, "no such window");
+            naczelnik(k);
+        }
+    };
+
+    template <int M>
+    inline interesant *city_hall<M>::nowy_interesant(int k)
+    {
+        assert(0 <= k && k < M);
+        interesant* out = (interesant*)malloc(sizeof(interesant));
+        out->num = counter++;
+        out->it = (*this)[(size_t)k].push_back(out);
+        out->tag = nullptr;
+        out->arrived = out->moved = out->served = 0;
+        return out;
+    }
+
+    template <int M>
+    inline interesant *city_hall<M>::obsluz(int k)
+    {
+        assert(0 <= k && k < M);
+        if((*this)[(size_t)k].empty())
+            return nullptr;
+        return (*this)[(size_t)k].pop_front();
+    }
+
+    template <int M>
+    inline void city_hall<M>::zmiana_okienka(interesant *i, int k)
+    {
+        assert(0 <= k && k < M);
+        plib::list<interesant*>::unlink(i->it);
+        i->it = (*this)[(size_t)k].push_back(i);
+    }
+
+    template <int M>
+    inline void city_hall<M>::zamkniecie_okienka(int k1, int k2)
+    {
+        assert(0 <= k1 && k1 < M && 0 <= k2 && k2 < M);
+        (*this)[(size_t)k2].merge_back((*this)[(size_t)k1]);
+    }
+
+    template <int M>
+    inline std::vector<interesant *> city_hall<M>::fast_track(interesant *i1, interesant *i2)
+    {
+        auto it = direct(i1->it, i2->it);
+        std::vector<interesant*> out;
+
+        while(it != i2->it)
+        {
+            out.push_back(*it);
+            it = plib::list<interesant*>::unlink(it);
+        }
+
+        out.push_back(i2);
+        plib::list<interesant*>::unlink(i2->it);
+
+        return out;
+    }
+
+    template <int M>
+    inline void city_hall<M>::naczelnik(int k)
+    {
+        assert(0 <= k && k < M);
+        (*this)[(size_t)k].reverse();
+    }
+
+    template <int M>
+    inline std::vector<interesant *> city_hall<M>::zamkniecie_urzedu()
+    {
+        std::vector<interesant*> out;
+        for(auto& queue : *this)
+            while(!queue.empty())
+                out.push_back(queue.pop_front());
+
+        return out;
+    }
+}
+
+#endif
@@ -56,7 +56,7 @@ namespace plib
 
         list();
         list(const list&);
-        list(list&&);
+        list(list&&) noexcept;
 
         /**
          * @brief iange constructor. Creates a list from the elements in the range [bgn, end).
@@ -231,6 +231,16 @@ namespace plib
          */
         iterator erase(const const_iterator& pos);
 
+        /**
+         * @brief erases the element at the specified position without access to the list holding it.
+         *
+         * @param pos iterator pointing to the element to be erased.
+         * @return iterator pointing to the element following the erased element.
+         * 
+         * Time complexity O(1)
+         */
+        static iterator unlink(const const_iterator& pos);
+
         /**
          * @brief removes the element at the specified position and returns it.
          *
@@ -251,6 +261,52 @@ namespace plib
          */
         void reverse();
 
+        /**
+         * @brief reverses the order of elements in the range [first, last].
+         *
+         * @param first iterator to the first element of the range, directed at last (see direct).
+         * @param last iterator to the last element of the range, directed at first.
+         * 
+         * Time complexity O(1)
+         */
+        static void reverse(const const_iterator& first, const const_iterator& last);
+
+        /**
+         * @brief moves the range [first, last] before the specified position.
+         *
+         * The range may come from this or from another list, but pos must not lie inside it
+         * (pos == first is allowed and changes nothing).
+         *
+         * @param pos iterator before which to move the range.
+         * @param first iterator to the first element of the range, directed at last (see direct).
+         * @param last iterator to the last element of the range, directed at first.
+         * @return iterator to the first moved element.
+         * 
+         * Time complexity O(1)
+         */
+        static iterator splice(const const_iterator& pos, const const_iterator& first, const const_iterator& last);
+
+        /**
+         * @brief moves the elements of other from first to its end before the specified position.
+         *
+         * @param pos iterator before which to move the elements.
+         * @param other list from which the elements are taken.
+         * @param first iterator to the first moved element of other, directed at other.end().
+         * @return iterator pointing to the first moved element or pos if first == other.end().
+         * 
+         * Time complexity O(1)
+         */
+        iterator splice(const const_iterator& pos, list& other, const const_iterator& first);
+
+        /**
+         * @brief rotates the list so that pos becomes its first element.
+         *
+         * @param pos iterator to an element of the list, directed at end().
+         * 
+         * Time complexity O(1)
+         */
+        void rotate(const const_iterator& pos);
+
         /**
          * @brief erases every element from the list
          * 
@@ -368,8 +424,6 @@ namespace plib
         };
 
     private:
-        node *_before_first; // guardian of begin
-        node *_past_last;    // guardian of end
         bool direction() const;
 
         iterator before_begin();
@@ -387,9 +441,14 @@ namespace plib
             value_type _value; // value_type stored in this node
             node *_next[2];    // neighbors in the list in arbitrary order
         };
+
+        node _guardians[2];  // stored in the list, so an empty list allocates nothing
+        node *_before_first; // guardian of begin
+        node *_past_last;    // guardian of end
+
         template <typename... Args>
         node *make_node(node *const previous = nullptr, node *const next = nullptr, Args &&...args);
-        void destroy_node(node *to_delete);
+        static void destroy_node(node *to_delete);
 
         /**
          * @brief helper function links nodes of two iterators together
@@ -399,16 +458,22 @@ namespace plib
          * @tparam it2_t class of the second iterator
          */
         template <typename it1_t, typename it2_t>
-        void link(const it1_t &, const it2_t &);
+        static void link(const it1_t &, const it2_t &);
+
+        /**
+         * @brief helper function returning an iterator to the same node, facing the other way
+         */
+        static iterator turned(const iterator &);
     };
 
     template <class T>
     void swap(list<T>& l1, list<T>& l2)
     {
-        using std::swap;
-        swap(l1._before_first, l2._before_first);
-        swap(l1._past_last, l2._past_last);
-        swap(l1._direction, l2._direction);
+        // guardians cannot change owners, so the elements are moved between them
+        list<T> tmp;
+        tmp.merge_back(l1);
+        l1.merge_back(l2);
+        l2.merge_back(tmp);
     }
 
     template <class T>
@@ -510,7 +575,7 @@ namespace plib
 
     template <class T>
     inline list<T>::list()
-        : _before_first(make_node()), _past_last(make_node())
+        : _guardians{}, _before_first(&_guardians[0]), _past_last(&_guardians[1])
     { link(before_begin(), end()); }
 
     template <class T>
@@ -530,7 +595,7 @@ namespace plib
     { }
 
     template <class T>
-    inline list<T>::list(list &&other)
+    inline list<T>::list(list &&other) noexcept
         :list()
     { swap(*this, other); }
 
@@ -715,6 +780,10 @@ namespace plib
 
     template <class T>
     inline typename list<T>::iterator list<T>::erase(const const_iterator &pos)
+    { return unlink(pos); }
+
+    template <class T>
+    inline typename list<T>::iterator list<T>::unlink(const const_iterator &pos)
     {
         auto copy = next(pos);
         link(prev(pos), next(pos));
@@ -771,12 +840,63 @@ namespace plib
     inline void list<T>::reverse()
     { std::swap(_before_first, _past_last); }
 
+    template <class T>
+    inline typename list<T>::iterator list<T>::turned(const iterator &it)
+    { return {it._current, !it._direction, it._const_linking}; }
+
+    template <class T>
+    inline void list<T>::reverse(const const_iterator &first, const const_iterator &last)
+    {
+        if(first == last)
+            return;
+
+        auto before = prev(first);
+        auto after = prev(last);
+        link(before, last);
+        link(after, first);
+    }
+
+    template <class T>
+    inline typename list<T>::iterator list<T>::splice
+        (const const_iterator &pos, const const_iterator &first, const const_iterator &last)
+    {
+        if(pos == first)
+            return first;
+
+        // a single element range faces both ways, the direction of last is then meaningless
+        const iterator back = first == last ? turned(first) : iterator(last);
+
+        link(prev(first), turned(prev(back)));
+
+        link(prev(pos), first);
+        link(turned(back), pos);
+
+        return first;
+    }
+
+    template <class T>
+    inline typename list<T>::iterator list<T>::splice
+        (const const_iterator &pos, list &other, const const_iterator &first)
+    {
+        if(first == other.cend())
+            return pos;
+
+        return splice(pos, first, turned(prev(other.end())));
+    }
+
+    template <class T>
+    inline void list<T>::rotate(const const_iterator &pos)
+    {
+        if(pos == cbegin() || pos == cend())
+            return;
+
+        splice(cend(), cbegin(), turned(prev(pos)));
+    }
+
     template <class T>
     inline list<T>::~list()
     {
         clear();
-        destroy_node(_before_first);
-        destroy_node(_past_last);
     }
 
     template <class T>
@@ -0,0 +1,494 @@
+/**
+ * @file symulator.cpp
+ * @brief discrete-event simulation of an office day on top of kol.h
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 kol.cpp dziennik.cpp kol_plik.cpp symulator.cpp -o symulator
+ *
+ * Run with optional key=value arguments, e.g.
+ *   ./symulator okienka=32 czas=28800 przybycia=0.02,0.05 obsluga=30 zmiany=0.1
+ *
+ * Arguments:
+ *   okienka=M          number of windows (16)
+ *   czas=T             length of the simulated day in seconds (28800)
+ *   przybycia=r,...    arrival rate per window in customers/s; the last value
+ *                      repeats for the remaining windows (0.03)
+ *   obsluga=s,...      mean service time per clerk in seconds, repeating like
+ *                      przybycia (30)
+ *   rozklad_przybyc=R,...
+ *                      distribution of gaps between arrivals per window:
+ *                      wykladniczy, staly or jednostajny, repeating like
+ *                      przybycia (wykladniczy)
+ *   rozklad_obslugi=R,...
+ *                      distribution of service times per clerk, repeating like
+ *                      obsluga (wykladniczy)
+ *   rozklad=R,...      sets both of the above
+ *   zmiany=r           zmiana_okienka events per second, hall-wide (0.01)
+ *   ekspres=r          fast_track events per second (0.002)
+ *   ekspres_dlugosc=n  largest number of customers served by one fast_track;
+ *                      each event takes a random run of 1 to n customers
+ *                      standing one after another in one queue (4)
+ *   naczelnik=r        naczelnik events per second (0.0005)
+ *   zamkniecia=r       zamkniecie_okienka events per second (0.0002)
+ *   probka=s           queue depth sampling interval in seconds (600)
+ *   ziarno=n           random seed (1)
+ *   plik=F             run on the file-backed engine, with the hall in file F;
+ *                      an existing F is removed first and the file is kept
+ *   pojemnosc=n        capacity of the file-backed hall; arrivals past it are
+ *                      turned away (1048576)
+ *
+ * Prints a queue depth timeline (simulated time, customers waiting, longest
+ * queue) followed by a summary: library operations per second of wall time,
+ * peak resident memory and simulated wait time quantiles.
+ */
+
+#include "kol.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace
+{
+    enum class distribution { exponential, constant, uniform };
+
+    struct config
+    {
+        int windows = 16;
+        double day = 28800;
+        std::vector<double> arrival_rates{0.03};
+        std::vector<double> service_means{30};
+        std::vector<distribution> arrival_dists{distribution::exponential};
+        std::vector<distribution> service_dists{distribution::exponential};
+        double moves = 0.01;
+        double express = 0.002;
+        int express_span = 4;
+        double chief = 0.0005;
+        double closings = 0.0002;
+        double sample = 600;
+        unsigned seed = 1;
+        const char *file = nullptr;
+        int capacity = 1 << 20;
+    };
+
+    enum class event_type { arrival, service_done, move, express, chief, closing, sample };
+
+    struct event
+    {
+        double time;
+        event_type type;
+        int window;
+
+        bool operator<(const event &other) const
+        { return time > other.time; }
+    };
+
+    std::vector<double> parse_list(const char *s)
+    {
+        std::vector<double> out;
+        for(const char *p = s; *p; )
+        {
+            char *end;
+            out.push_back(std::strtod(p, &end));
+            p = *end == ',' ? end + 1 : end + std::strlen(end);
+        }
+        return out;
+    }
+
+    bool parse_distributions(const char *s, std::vector<distribution> &out)
+    {
+        out.clear();
+        for(const char *p = s; *p; )
+        {
+            size_t len = std::strcspn(p, ",");
+            std::string name(p, len);
+            if(name == "wykladniczy")
+                out.push_back(distribution::exponential);
+            else if(name == "staly")
+                out.push_back(distribution::constant);
+            else if(name == "jednostajny")
+                out.push_back(distribution::uniform);
+            else
+                return false;
+            p += p[len] == ',' ? len + 1 : len;
+        }
+        return !out.empty();
+    }
+
+    bool parse_argument(config &cfg, const char *arg)
+    {
+        const char *eq = std::strchr(arg, '=');
+        if(!eq)
+            return false;
+        std::string key(arg, eq);
+        const char *val = eq + 1;
+
+        if(key == "okienka")
+            cfg.windows = std::atoi(val);
+        else if(key == "czas")
+            cfg.day = std::atof(val);
+        else if(key == "przybycia")
+            cfg.arrival_rates = parse_list(val);
+        else if(key == "obsluga")
+            cfg.service_means = parse_list(val);
+        else if(key == "rozklad_przybyc")
+            return parse_distributions(val, cfg.arrival_dists);
+        else if(key == "rozklad_obslugi")
+            return parse_distributions(val, cfg.service_dists);
+        else if(key == "rozklad")
+            return parse_distributions(val, cfg.arrival_dists)
+                && parse_distributions(val, cfg.service_dists);
+        else if(key == "zmiany")
+            cfg.moves = std::atof(val);
+        else if(key == "ekspres")
+            cfg.express = std::atof(val);
+        else if(key == "ekspres_dlugosc")
+            cfg.express_span = std::atoi(val);
+        else if(key == "naczelnik")
+            cfg.chief = std::atof(val);
+        else if(key == "zamkniecia")
+            cfg.closings = std::atof(val);
+        else if(key == "probka")
+            cfg.sample = std::atof(val);
+        else if(key == "ziarno")
+            cfg.seed = (unsigned)std::atol(val);
+        else if(key == "plik")
+            cfg.file = val;
+        else if(key == "pojemnosc")
+            cfg.capacity = std::atoi(val);
+        else
+            return false;
+        return true;
+    }
+
+    template <class T>
+    T per_window(const std::vector<T> &values, int k)
+    {
+        if(values.empty())
+            return T();
+        return values[std::min((size_t)k, values.size() - 1)];
+    }
+
+    /**
+     * @class simulation
+     * @brief holds the event queue and the bookkeeping needed to pick customers
+     */
+    class simulation
+    {
+    public:
+        explicit simulation(const config &c) : cfg(c), rng(c.seed), idle((size_t)c.windows, true)
+        { }
+
+        void run();
+
+    private:
+        const config &cfg;
+        std::mt19937_64 rng;
+        std::priority_queue<event> events;
+        double now = 0;
+        long long operations = 0;
+
+        std::vector<bool> idle;                  // clerk has nobody to serve
+        std::vector<interesant*> customers;      // every customer, by numerek
+        std::vector<double> arrived;             // simulated arrival time, by numerek
+        std::vector<int> waiting_slot;           // index in waiting or -1, by numerek
+        std::vector<interesant*> waiting;        // customers standing in some queue
+        std::vector<double> waits;
+        long long rejected = 0;
+
+        double gap(distribution dist, double mean)
+        {
+            switch(dist)
+            {
+            case distribution::constant:
+                return mean;
+            case distribution::uniform:
+                return std::uniform_real_distribution<double>(0, 2 * mean)(rng);
+            case distribution::exponential:
+                break;
+            }
+            return std::exponential_distribution<double>(1 / mean)(rng);
+        }
+
+        int random_window()
+        { return (int)std::uniform_int_distribution<int>(0, cfg.windows - 1)(rng); }
+
+        // hall-wide events come at exponential gaps
+        void schedule(double rate, event_type type)
+        {
+            if(rate > 0)
+                events.push({now + gap(distribution::exponential, 1 / rate), type, 0});
+        }
+
+        void schedule_arrival(int k)
+        {
+            double rate = per_window(cfg.arrival_rates, k);
+            if(rate > 0)
+                events.push({now + gap(per_window(cfg.arrival_dists, k), 1 / rate),
+                             event_type::arrival, k});
+        }
+
+        void schedule_service(int k)
+        {
+            double mean = per_window(cfg.service_means, k);
+            double t = mean > 0 ? gap(per_window(cfg.service_dists, k), mean) : 0;
+            events.push({now + t, event_type::service_done, k});
+        }
+
+        // a clerk with nobody to serve starts as soon as someone comes
+        void kick(int k)
+        {
+            if(idle[(size_t)k])
+            {
+                idle[(size_t)k] = false;
+                events.push({now, event_type::service_done, k});
+            }
+        }
+
+        void leave(interesant *i)
+        {
+            int num = numerek(i);
+            int slot = waiting_slot[(size_t)num];
+            waiting_slot[(size_t)numerek(waiting.back())] = slot;
+            waiting[(size_t)slot] = waiting.back();
+            waiting.pop_back();
+            waiting_slot[(size_t)num] = -1;
+        }
+
+        interesant *random_waiting()
+        {
+            if(waiting.empty())
+                return nullptr;
+            auto j = std::uniform_int_distribution<size_t>(0, waiting.size() - 1)(rng);
+            return waiting[j];
+        }
+
+        void express();
+        void handle(const event &e);
+        void sample() const;
+        void report(double seconds) const;
+    };
+
+    void simulation::run()
+    {
+        if(cfg.file)
+        {
+            std::remove(cfg.file);
+            if(!otwarcie_urzedu_z_pliku(cfg.file, cfg.windows, cfg.capacity))
+            {
+                std::fprintf(stderr, "nie mozna otworzyc pliku %s\n", cfg.file);
+                return;
+            }
+        }
+        else
+            otwarcie_urzedu(cfg.windows);
+        ++operations;
+
+        for(int k = 0; k < cfg.windows; ++k)
+            schedule_arrival(k);
+        schedule(cfg.moves, event_type::move);
+        schedule(cfg.express, event_type::express);
+        schedule(cfg.chief, event_type::chief);
+        schedule(cfg.closings, event_type::closing);
+        events.push({0, event_type::sample, 0});
+
+        std::printf("# czas[s] czekajacy najdluzsza_kolejka\n");
+        auto start = std::chrono::steady_clock::now();
+
+        while(!events.empty() && events.top().time <= cfg.day)
+        {
+            event e = events.top();
+            events.pop();
+            now = e.time;
+            handle(e);
+        }
+
+        std::vector<interesant*> left = zamkniecie_urzedu();
+        ++operations;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        report(seconds);
+        std::printf("pozostalo w kolejkach: %zu\n", left.size());
+
+        // customers of the file-backed hall live in the mapping
+        if(cfg.file)
+            zamkniecie_pliku();
+        else
+            for(interesant *i : customers)
+                free(i);
+    }
+
+    // fast_track needs a run of customers from one queue, in queue order, which
+    // only the library knows; events are rare, so a full export is cheap enough
+    void simulation::express()
+    {
+        if(waiting.empty())
+            return;
+        eksport_kolejek e = eksport();
+
+        int k;
+        do
+            k = random_window();
+        while(e.poczatki[(size_t)k] == e.poczatki[(size_t)k + 1]);
+
+        int bgn = e.poczatki[(size_t)k], end = e.poczatki[(size_t)k + 1];
+        int first = std::uniform_int_distribution<int>(bgn, end - 1)(rng);
+        int last = std::min(end - 1, first + std::uniform_int_distribution<int>(
+                                                 0, std::max(cfg.express_span, 1) - 1)(rng));
+
+        interesant *i1 = customers[(size_t)e.numerki[(size_t)first]];
+        interesant *i2 = customers[(size_t)e.numerki[(size_t)last]];
+        for(interesant *served : fast_track(i1, i2))
+        {
+            leave(served);
+            waits.push_back(now - arrived[(size_t)numerek(served)]);
+        }
+        ++operations;
+    }
+
+    void simulation::handle(const event &e)
+    {
+        switch(e.type)
+        {
+        case event_type::arrival:
+        {
+            interesant *i = nowy_interesant(e.window);
+            ++operations;
+            schedule_arrival(e.window);
+            if(!i)
+            {
+                ++rejected;
+                break;
+            }
+            customers.push_back(i);
+            arrived.push_back(now);
+            waiting_slot.push_back((int)waiting.size());
+            waiting.push_back(i);
+            kick(e.window);
+            break;
+        }
+        case event_type::service_done:
+        {
+            interesant *i = obsluz(e.window);
+            ++operations;
+            if(!i)
+            {
+                idle[(size_t)e.window] = true;
+                break;
+            }
+            leave(i);
+            waits.push_back(now - arrived[(size_t)numerek(i)]);
+            schedule_service(e.window);
+            break;
+        }
+        case event_type::move:
+        {
+            if(interesant *i = random_waiting())
+            {
+                int k = random_window();
+                zmiana_okienka(i, k);
+                ++operations;
+                kick(k);
+            }
+            schedule(cfg.moves, event_type::move);
+            break;
+        }
+        case event_type::express:
+            express();
+            schedule(cfg.express, event_type::express);
+            break;
+        case event_type::chief:
+            naczelnik(random_window());
+            ++operations;
+            schedule(cfg.chief, event_type::chief);
+            break;
+        case event_type::closing:
+        {
+            int k1 = random_window(), k2 = random_window();
+            if(k1 != k2)
+            {
+                zamkniecie_okienka(k1, k2);
+                ++operations;
+                kick(k2);
+            }
+            schedule(cfg.closings, event_type::closing);
+            break;
+        }
+        case event_type::sample:
+            sample();
+            if(cfg.sample > 0)
+                events.push({now + cfg.sample, event_type::sample, 0});
+            break;
+        }
+    }
+
+    void simulation::sample() const
+    {
+        // dlugosc_kolejki is not available on the file-backed engine
+        int longest = 0;
+        if(cfg.file)
+        {
+            eksport_kolejek e = eksport();
+            for(int k = 0; k < cfg.windows; ++k)
+                longest = std::max(longest, e.poczatki[(size_t)k + 1] - e.poczatki[(size_t)k]);
+        }
+        else
+            for(int k = 0; k < cfg.windows; ++k)
+                longest = std::max(longest, dlugosc_kolejki(k));
+        std::printf("%.0f %zu %d\n", now, waiting.size(), longest);
+    }
+
+    void simulation::report(double seconds) const
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        std::printf("operacje: %lld\n", operations);
+        std::printf("czas symulacji: %.3f s\n", seconds);
+        std::printf("operacje/s: %.0f\n", seconds > 0 ? (double)operations / seconds : 0.0);
+        std::printf("szczytowa pamiec: %ld KiB\n", usage.ru_maxrss);
+        std::printf("obsluzeni: %zu\n", waits.size());
+        if(rejected)
+            std::printf("odeslani (pelny plik): %lld\n", rejected);
+
+        if(waits.empty())
+            return;
+        std::vector<double> sorted = waits;
+        std::sort(sorted.begin(), sorted.end());
+        for(double q : {0.5, 0.99, 0.999})
+            std::printf("oczekiwanie p%g: %.1f s\n", q * 100,
+                        sorted[(size_t)(q * (double)(sorted.size() - 1))]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    config cfg;
+    for(int j = 1; j < argc; ++j)
+        if(!parse_argument(cfg, argv[j]))
+        {
+            std::fprintf(stderr, "nieznany argument: %s\n", argv[j]);
+            return 1;
+        }
+
+    if(cfg.windows <= 0 || cfg.day < 0)
+    {
+        std::fprintf(stderr, "potrzebne jest co najmniej jedno okienko i nieujemny czas\n");
+        return 1;
+    }
+
+    if(cfg.file && cfg.capacity < 0)
+    {
+        std::fprintf(stderr, "pojemnosc nie moze byc ujemna\n");
+        return 1;
+    }
+
+    simulation(cfg).run();
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file test_dziennik.cpp
+ * @brief checks of the shared-memory operation log: replay, gap detection
+ * and rejection of objects that are not a whole log
+ *
+ * Build:
+ *   g++ -std=c++17 kol.cpp dziennik.cpp kol_plik.cpp test_dziennik.cpp -o test_dziennik -pthread -lrt
+ */
+
+#include "kol.h"
+#include "dziennik.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// unlike assert, stays on in NDEBUG builds, since the checks call the library
+#define CHECK(x) ((x) ? (void)0 : (std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", \
+                                                __FILE__, __LINE__, #x), std::abort()))
+
+namespace
+{
+    const char *log_name = "/test_dziennik";
+
+    // the hall is per thread, so the primary and each replica get a thread of
+    // their own
+    void replay_matches_primary()
+    {
+        std::thread([] {
+            CHECK(publikuj_dziennik(log_name, 1024));
+            otwarcie_urzedu(3);
+            interesant *a = nowy_interesant(0);
+            interesant *b = nowy_interesant(0);
+            interesant *c = nowy_interesant(1);
+            nowy_interesant(2);
+
+            replika *r = dolacz_do_dziennika(log_name);
+            CHECK(r);
+
+            zmiana_okienka(a, 2);
+            naczelnik(2);
+            free(fast_track(b, b)[0]);
+            zamkniecie_okienka(1, 0);
+            otworz_okienko();
+            naczelnik_zakres(c, c);
+            free(obsluz(2));
+            eksport_kolejek primary = eksport();
+
+            std::thread([&] {
+                long long done = odtworz_dziennik(r, 5);
+                CHECK(done == 5);
+                done += odtworz_dziennik(r, 1000);
+                CHECK(done == 12);
+                CHECK(utracone_wpisy(r) == 0);
+
+                eksport_kolejek copy = eksport();
+                CHECK(copy.licznik == primary.licznik);
+                CHECK(copy.numerki == primary.numerki);
+                CHECK(copy.okienka == primary.okienka);
+                CHECK(copy.poczatki == primary.poczatki);
+                CHECK(odtworz_dziennik(r, 1000) == 0);
+                odlacz_od_dziennika(r);
+                for(interesant *i : zamkniecie_urzedu())
+                    free(i);
+            }).join();
+
+            zakoncz_dziennik();
+            for(interesant *i : zamkniecie_urzedu())
+                free(i);
+        }).join();
+    }
+
+    void lapped_replica_reports_the_gap()
+    {
+        std::thread([] {
+            CHECK(publikuj_dziennik(log_name, 8));
+            replika *r = dolacz_do_dziennika(log_name);
+            CHECK(r);
+
+            otwarcie_urzedu(1);
+            for(int j = 0; j < 19; ++j)
+                naczelnik(0);
+
+            std::thread([&] {
+                // head 20, next 1: entries 1..12 are gone, 13..20 still in the ring
+                CHECK(odtworz_dziennik(r, 1000) == -1);
+                CHECK(utracone_wpisy(r) == 12);
+                CHECK(odtworz_dziennik(r, 1000) == -1);
+                odlacz_od_dziennika(r);
+            }).join();
+
+            zakoncz_dziennik();
+        }).join();
+    }
+
+    void unknown_customer_is_a_gap()
+    {
+        std::thread([] {
+            otwarcie_urzedu(2);
+            interesant *a = nowy_interesant(0);
+
+            // the replica attaches after a came, so it has never seen a
+            CHECK(publikuj_dziennik(log_name, 64));
+            replika *r = dolacz_do_dziennika(log_name);
+            zmiana_okienka(a, 1);
+
+            std::thread([&] {
+                otwarcie_urzedu(2);
+                CHECK(odtworz_dziennik(r, 1000) == -1);
+                CHECK(utracone_wpisy(r) == 1);
+                odlacz_od_dziennika(r);
+            }).join();
+
+            zakoncz_dziennik();
+            free(a);
+        }).join();
+    }
+
+    void truncated_object_is_rejected()
+    {
+        int fd = shm_open(log_name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+        CHECK(fd >= 0);
+        // a valid magic and a capacity of 1024 entries in a 64-byte object
+        uint64_t header[3] = {0x6b6f6c656a6b6931, 1024, 0};
+        CHECK(ftruncate(fd, 64) == 0);
+        CHECK(write(fd, header, sizeof(header)) == (ssize_t)sizeof(header));
+        close(fd);
+        CHECK(!dolacz_do_dziennika(log_name));
+
+        // and a capacity that is not a power of two
+        fd = shm_open(log_name, O_RDWR, 0);
+        header[1] = 3;
+        CHECK(pwrite(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header));
+        close(fd);
+        CHECK(!dolacz_do_dziennika(log_name));
+
+        shm_unlink(log_name);
+        CHECK(!dolacz_do_dziennika(log_name));
+    }
+}
+
+int main()
+{
+    replay_matches_primary();
+    lapped_replica_reports_the_gap();
+    unknown_customer_is_a_gap();
+    truncated_object_is_rejected();
+    std::puts("test_dziennik: OK");
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file test_plik.cpp
+ * @brief checks of the city hall stored in a file: reopening it, rejecting
+ * files that are not a valid hall, and what a full file sends to the log
+ *
+ * Build:
+ *   g++ -std=c++17 kol.cpp dziennik.cpp kol_plik.cpp test_plik.cpp -o test_plik -pthread -lrt
+ */
+
+#include "kol.h"
+#include "dziennik.h"
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+// unlike assert, stays on in NDEBUG builds, since the checks call the library
+#define CHECK(x) ((x) ? (void)0 : (std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", \
+                                                __FILE__, __LINE__, #x), std::abort()))
+
+namespace
+{
+    const char *file_name = "test_plik.dat";
+    const char *log_name = "/test_plik";
+
+    bool same(const eksport_kolejek &a, const eksport_kolejek &b)
+    {
+        return a.licznik == b.licznik && a.numerki == b.numerki && a.okienka == b.okienka
+            && a.poczatki == b.poczatki;
+    }
+
+    // the hall is per thread and a file cannot be opened where otwarcie_urzedu
+    // was called, so every check gets a thread of its own
+    template <typename F>
+    void in_thread(F f)
+    {
+        std::thread(f).join();
+    }
+
+    void reopen_keeps_the_queues()
+    {
+        unlink(file_name);
+        eksport_kolejek before;
+
+        in_thread([&] {
+            CHECK(otwarcie_urzedu_z_pliku(file_name, 3, 10));
+            interesant *a = nowy_interesant(0);
+            interesant *b = nowy_interesant(0);
+            nowy_interesant(1);
+            interesant *d = nowy_interesant(2);
+            nowy_interesant(2);
+
+            zmiana_okienka(a, 2);
+            naczelnik(2);
+            CHECK(obsluz(0) == b);
+            fast_track(d, d);
+            before = eksport();
+            zamkniecie_pliku();
+        });
+
+        in_thread([&] {
+            // m and pojemnosc of an existing file are ignored
+            CHECK(otwarcie_urzedu_z_pliku(file_name, 1, 0));
+            CHECK(same(eksport(), before));
+
+            // customers given out before are found again by their numbers
+            for(int num = 0; num < before.licznik; ++num)
+                CHECK(numerek(interesant_o_numerku(num)) == num);
+            CHECK(!interesant_o_numerku(before.licznik));
+
+            interesant *e = nowy_interesant(1);
+            CHECK(numerek(e) == before.licznik);
+            zamkniecie_okienka(2, 1);
+            eksport_kolejek after = eksport();
+            zamkniecie_pliku();
+
+            CHECK(otwarcie_urzedu_z_pliku(file_name, 1, 0));
+            CHECK(same(eksport(), after));
+            CHECK(zamkniecie_urzedu().size() == 4);
+            zamkniecie_pliku();
+        });
+
+        unlink(file_name);
+    }
+
+    void bad_shape_is_rejected()
+    {
+        in_thread([] {
+            unlink(file_name);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 0, 10));
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, -1));
+            // node 2m + capacity - 1 would be nil
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, INT_MAX, 1));
+            unlink(file_name);
+        });
+    }
+
+    // header fields: magic, windows, capacity, counter, padding
+    void write_header(int32_t windows, int32_t capacity, int32_t counter, off_t size)
+    {
+        unlink(file_name);
+        int fd = open(file_name, O_CREAT | O_RDWR, 0600);
+        CHECK(fd >= 0);
+        uint64_t magic = 0x6b6f6c706c696b31;
+        int32_t fields[4] = {windows, capacity, counter, 0};
+        CHECK(ftruncate(fd, size) == 0);
+        CHECK(pwrite(fd, &magic, sizeof(magic), 0) == (ssize_t)sizeof(magic));
+        CHECK(pwrite(fd, fields, sizeof(fields), sizeof(magic)) == (ssize_t)sizeof(fields));
+        close(fd);
+    }
+
+    void bad_header_is_rejected()
+    {
+        in_thread([] {
+            write_header(0, 10, 0, 4096);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, 10));
+            write_header(2, -1, 0, 4096);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, 10));
+            write_header(2, 10, 11, 4096);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, 10));
+            write_header(2, 10, -1, 4096);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, 10));
+            // a valid header in a file too short for its nodes
+            write_header(2, 10, 0, 64);
+            CHECK(!otwarcie_urzedu_z_pliku(file_name, 2, 10));
+            write_header(2, 10, 0, 4096);
+            CHECK(otwarcie_urzedu_z_pliku(file_name, 5, 5));
+            CHECK(eksport().poczatki.size() == 3);
+            zamkniecie_pliku();
+            unlink(file_name);
+        });
+    }
+
+    // a full file and an empty queue give nobody out, so the log must not
+    // tell the replica otherwise
+    void full_file_logs_nothing()
+    {
+        in_thread([] {
+            unlink(file_name);
+            CHECK(publikuj_dziennik(log_name, 64));
+            replika *r = dolacz_do_dziennika(log_name);
+            CHECK(r);
+
+            CHECK(otwarcie_urzedu_z_pliku(file_name, 2, 2));
+            CHECK(nowy_interesant(0));
+            CHECK(nowy_interesant(1));
+            CHECK(!nowy_interesant(0));
+            CHECK(obsluz(1));
+            CHECK(!obsluz(1));
+            eksport_kolejek primary = eksport();
+
+            in_thread([&] {
+                CHECK(odtworz_dziennik(r, 1000) == 4);
+                CHECK(utracone_wpisy(r) == 0);
+                CHECK(same(eksport(), primary));
+                odlacz_od_dziennika(r);
+                for(interesant *i : zamkniecie_urzedu())
+                    free(i);
+            });
+
+            zakoncz_dziennik();
+            zamkniecie_pliku();
+            unlink(file_name);
+        });
+    }
+}
+
+int main()
+{
+    reopen_keeps_the_queues();
+    bad_shape_is_rejected();
+    bad_header_is_rejected();
+    full_file_logs_nothing();
+    std::puts("test_plik: OK");
+    return 0;
+}
@@ -0,0 +1,314 @@
+/**
+ * @file test_plist.cpp
+ * @brief checks of the relinking operations of plib::list, swap and move
+ * against std::deque
+ *
+ * Build:
+ *   g++ -std=c++17 test_plist.cpp -o test_plist
+ */
+
+#include "plist.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <random>
+
+// unlike assert, stays on in NDEBUG builds, since the checks call the library
+#define CHECK(x) ((x) ? (void)0 : (std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", \
+                                                __FILE__, __LINE__, #x), std::abort()))
+
+namespace
+{
+    using list = plib::list<int>;
+    using model = std::deque<int>;
+    using iter = list::const_iterator;
+
+    /**
+     * @brief checks the list both ways, which catches a broken link in either direction
+     */
+    void check_same(const list &l, const model &m)
+    {
+        model forward(l.begin(), l.end());
+        CHECK(forward == m);
+
+        model backward;
+        for(auto it = l.cend(); it != l.cbegin(); )
+            backward.push_front(*--it);
+        CHECK(backward == m);
+    }
+
+    iter at(list &l, size_t j)
+    {
+        auto it = l.cbegin();
+        for(size_t s = 0; s < j; ++s)
+            ++it;
+        return it;
+    }
+
+    // the range [j1, j2] of l as the (first, last) pair the static operations take
+    std::pair<iter, iter> range(list &l, size_t j1, size_t j2)
+    {
+        iter a = at(l, j1), b = at(l, j2);
+        return {direct(a, b), direct(b, a)};
+    }
+
+    model take(model &m, size_t j1, size_t j2)
+    {
+        model out(m.begin() + (long)j1, m.begin() + (long)j2 + 1);
+        m.erase(m.begin() + (long)j1, m.begin() + (long)j2 + 1);
+        return out;
+    }
+
+    void fill(list &l, model &m, int from, int count)
+    {
+        for(int v = from; v < from + count; ++v)
+        {
+            l.push_back(v);
+            m.push_back(v);
+        }
+    }
+
+    void edge_cases()
+    {
+        list l;
+        model m;
+        fill(l, m, 0, 5);
+
+        // a single element range faces both ways
+        auto r = range(l, 3, 3);
+        list::splice(l.cbegin(), r.first, r.second);
+        m = {3, 0, 1, 2, 4};
+        check_same(l, m);
+
+        // pos right after the range and pos at its first element change nothing
+        r = range(l, 1, 2);
+        list::splice(at(l, 3), r.first, r.second);
+        check_same(l, m);
+        r = range(l, 1, 2);
+        list::splice(r.first, r.first, r.second);
+        check_same(l, m);
+
+        // the whole list to the end, and a range already at the front
+        r = range(l, 0, 4);
+        list::splice(l.cend(), r.first, r.second);
+        check_same(l, m);
+        r = range(l, 0, 1);
+        list::splice(l.cbegin(), r.first, r.second);
+        check_same(l, m);
+
+        // a single element and the whole list reversed in place
+        r = range(l, 2, 2);
+        list::reverse(r.first, r.second);
+        check_same(l, m);
+        r = range(l, 0, 4);
+        list::reverse(r.first, r.second);
+        std::reverse(m.begin(), m.end());
+        check_same(l, m);
+
+        // rotating to begin or end changes nothing
+        l.rotate(l.cbegin());
+        l.rotate(l.cend());
+        check_same(l, m);
+
+        // moving the tail of an empty list is a no-op, moving all of it empties it
+        list other;
+        l.splice(l.cbegin(), other, other.cbegin());
+        check_same(l, m);
+        l.splice(l.cend(), other, other.cbegin());
+        check_same(other, {});
+
+        model tail{7, 8};
+        other.push_back(7);
+        other.push_back(8);
+        l.splice(at(l, 2), other, other.cbegin());
+        m.insert(m.begin() + 2, tail.begin(), tail.end());
+        check_same(l, m);
+        check_same(other, {});
+
+        // the lists still work after everything above
+        l.push_front(-1);
+        m.push_front(-1);
+        l.reverse();
+        std::reverse(m.begin(), m.end());
+        check_same(l, m);
+    }
+
+    // swap and move relink the nodes through three merges, so the elements
+    // keep their addresses and iterators to them stay valid
+    void swap_and_move()
+    {
+        list a, b;
+        model ma, mb;
+        fill(a, ma, 0, 4);
+
+        iter first = a.cbegin();
+        const int *address = &*first;
+        swap(a, b);
+        std::swap(ma, mb);
+        check_same(a, ma);
+        check_same(b, mb);
+        CHECK(&*b.cbegin() == address && *first == 0);
+
+        // both non-empty, one of them reversed, so the lists face different ways
+        fill(a, ma, 10, 3);
+        b.reverse();
+        std::reverse(mb.begin(), mb.end());
+        swap(a, b);
+        std::swap(ma, mb);
+        check_same(a, ma);
+        check_same(b, mb);
+        swap(a, b);
+        std::swap(ma, mb);
+        check_same(a, ma);
+        check_same(b, mb);
+
+        list moved(std::move(b));
+        model mmoved = mb;
+        mb.clear();
+        check_same(moved, mmoved);
+        check_same(b, mb);
+        CHECK(&*std::prev(moved.cend()) == address);
+
+        // move assignment into a non-empty list drops its old elements
+        a = std::move(moved);
+        check_same(a, mmoved);
+        ma = mmoved;
+        check_same(moved, {});
+
+        // copy assignment leaves the source alone
+        b = a;
+        mb = ma;
+        check_same(a, ma);
+        check_same(b, mb);
+        CHECK(&*std::prev(a.cend()) == address);
+
+        // the lists still work after everything above
+        a.push_front(-1);
+        ma.push_front(-1);
+        b.pop_back();
+        mb.pop_back();
+        list::splice(a.cend(), direct(b.cbegin(), std::prev(b.cend())),
+                     direct(std::prev(b.cend()), b.cbegin()));
+        ma.insert(ma.end(), mb.begin(), mb.end());
+        check_same(a, ma);
+        check_same(b, {});
+    }
+
+    void random_operations()
+    {
+        std::mt19937 rng(2024);
+        auto pick = [&](size_t n) { return (size_t)std::uniform_int_distribution<size_t>(0, n)(rng); };
+
+        list lists[2];
+        model models[2];
+        int next_value = 0;
+
+        for(int step = 0; step < 200000; ++step)
+        {
+            size_t a = pick(1), b = 1 - a;
+            list &l = lists[a];
+            model &m = models[a];
+
+            switch(pick(8))
+            {
+            case 0:
+            case 1:
+                l.push_back(next_value);
+                m.push_back(next_value++);
+                break;
+            case 2:
+                if(!m.empty())
+                {
+                    CHECK(l.pop_front() == m.front());
+                    m.pop_front();
+                }
+                break;
+            case 3:
+                l.reverse();
+                std::reverse(m.begin(), m.end());
+                break;
+            case 4:
+            {
+                if(m.empty())
+                    break;
+                size_t j1 = pick(m.size() - 1), j2 = j1 + pick(m.size() - 1 - j1);
+                auto r = range(l, j1, j2);
+                list::reverse(r.first, r.second);
+                std::reverse(m.begin() + (long)j1, m.begin() + (long)j2 + 1);
+                break;
+            }
+            case 5:
+            {
+                // a range moved within its own list, pos outside it or at its first element
+                if(m.empty())
+                    break;
+                size_t j1 = pick(m.size() - 1), j2 = j1 + pick(m.size() - 1 - j1);
+                size_t p = pick(m.size() - (j2 - j1));
+                if(p > j1)
+                    p += j2 - j1;
+                auto r = range(l, j1, j2);
+                list::splice(at(l, p), r.first, r.second);
+
+                model moved = take(m, j1, j2);
+                size_t q = p > j1 ? p - moved.size() : p;
+                m.insert(m.begin() + (long)q, moved.begin(), moved.end());
+                break;
+            }
+            case 6:
+            {
+                // a range taken from the other list
+                model &from = models[b];
+                if(from.empty())
+                    break;
+                size_t j1 = pick(from.size() - 1), j2 = j1 + pick(from.size() - 1 - j1);
+                size_t p = pick(m.size());
+                auto r = range(lists[b], j1, j2);
+                list::splice(at(l, p), r.first, r.second);
+
+                model moved = take(from, j1, j2);
+                m.insert(m.begin() + (long)p, moved.begin(), moved.end());
+                break;
+            }
+            case 7:
+            {
+                // the tail of the other list, possibly empty
+                model &from = models[b];
+                size_t j = pick(from.size()), p = pick(m.size());
+                l.splice(at(l, p), lists[b], at(lists[b], j));
+
+                m.insert(m.begin() + (long)p, from.begin() + (long)j, from.end());
+                from.erase(from.begin() + (long)j, from.end());
+                break;
+            }
+            case 8:
+            {
+                size_t p = pick(m.size());
+                l.rotate(at(l, p));
+                std::rotate(m.begin(), m.begin() + (long)p, m.end());
+                break;
+            }
+            }
+
+            // long lists only slow the index walks down
+            while(m.size() > 40)
+            {
+                l.pop_back();
+                m.pop_back();
+            }
+
+            check_same(lists[0], models[0]);
+            check_same(lists[1], models[1]);
+        }
+    }
+}
+
+int main()
+{
+    edge_cases();
+    swap_and_move();
+    random_operations();
+    std::puts("test_plist: OK");
+    return 0;
+}